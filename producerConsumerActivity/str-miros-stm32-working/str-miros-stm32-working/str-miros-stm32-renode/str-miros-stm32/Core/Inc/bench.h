@@ -0,0 +1,27 @@
+/*
+ * bench.h
+ *
+ * Suíte de benchmarks do kernel no estilo do Thread-Metric, compilada com
+ * -DMIROS_BENCH no lugar da aplicação; roda headless no Renode (bench.resc)
+ * e imprime um CSV pela USART2.
+ */
+
+#ifndef INC_BENCH_H_
+#define INC_BENCH_H_
+
+#include <cstdint>
+
+#ifdef MIROS_BENCH
+// Cria as threads da suíte; chamar entre OS_init() e OS_run()
+void bench_start(void);
+
+// Ciclos do SysTick_Handler, para os benchmarks tick_N
+void bench_tick(uint32_t ciclos);
+#endif
+
+#if defined(MIROS_PROFILE) || defined(MIROS_BENCH)
+// USART2 TX em PA2, 115200 8N1 (main.cpp)
+void console_init(void);
+#endif
+
+#endif /* INC_BENCH_H_ */
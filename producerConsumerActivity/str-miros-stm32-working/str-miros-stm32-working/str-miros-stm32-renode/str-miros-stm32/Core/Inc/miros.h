@@ -1,59 +0,0 @@
-/*
- * miros.h
- *
- *  Created on: Feb 6, 2025
- *      Author: guilh
- */
-
-#ifndef INC_MIROS_H_
-#define INC_MIROS_H_
-
-namespace rtos {
-/* Thread Control Block (TCB) */
-typedef struct {
-    int16_t count;
-} OSSem;
-
-void OSSem_init(OSSem *s, int16_t count);
-void OSSem_wait(OSSem *s);
-void OSSem_signal(OSSem *s);
-
-typedef struct {
-    void *sp; /* stack pointer */
-    uint32_t timeout; /* timeout delay down-counter */
-    /* ... other attributes associated with a thread */
-} OSThread;
-
-const uint16_t TICKS_PER_SEC = 100U;
-
-typedef void (*OSThreadHandler)();
-
-void OS_init(void *stkSto, uint32_t stkSize);
-
-/* callback to handle the idle condition */
-void OS_onIdle(void);
-
-/* this function must be called with interrupts DISABLED */
-void OS_sched(void);
-
-/* transfer control to the RTOS to run the threads */
-void OS_run(void);
-
-/* blocking delay */
-void OS_delay(uint32_t ticks);
-
-/* process all timeouts */
-void OS_tick(void);
-
-/* callback to configure and start interrupts */
-void OS_onStartup(void);
-
-void OSThread_start(
-    OSThread *me,
-    OSThreadHandler threadHandler,
-    void *stkSto, uint32_t stkSize);
-
-
-}
-
-#endif /* INC_MIROS_H_ */
@@ -0,0 +1,735 @@
+/*
+ * bench.cpp
+ *
+ * Suíte de benchmarks do kernel (-DMIROS_BENCH), no estilo do Thread-Metric.
+ * Um controlador roda os benchmarks um de cada vez; cada um mede BENCH_OPS
+ * operações com o DWT->CYCCNT e o controlador imprime pela USART2 uma linha
+ * de CSV com operações/s e a distribuição dos ciclos por operação:
+ *
+ *   bench,ops,ops_per_sec,mean,min,p50,p90,p99,max,switches
+ *
+ * coop      troca cooperativa: a thread alta bloqueia e a baixa volta a rodar
+ * preempt   troca preemptiva: o post acorda uma thread mais alta (cadeia de 5)
+ * pingpong  ida e volta entre duas threads por dois semáforos
+ * msg       envio de um ponteiro por OSQueue até a thread que espera recebê-lo
+ * isr       interrupção (IRQ pendente por software) até a thread acordada rodar
+ * jitter    intervalo entre interrupções do TIM2 a JITTER_HZ, acima de
+ *           MIROS_SYSCALL_PRIO, com o kernel ocupado por um pingpong; o jitter
+ *           é max - min (compare com um build -DMIROS_SYSCALL_PRIO=0)
+ * pc        produtor baixo e consumidor alto por uma OSQueue de 4 mensagens;
+ *           ciclos entre duas mensagens recebidas
+ * pc_limiar o mesmo, com o limiar de preempção do produtor na prioridade do
+ *           consumidor: ele enche a fila antes de ceder a CPU
+ * inv_sem   inversão de prioridade L/M/H: a baixa trava um semáforo, acorda a
+ *           alta, que bloqueia nele, e a média, que ocupa INV_CICLOS_MEDIA;
+ *           ciclos que a alta espera pela trava (a média atrasa a baixa)
+ * inv_mutex o mesmo com um OSMutex: a baixa herda a prioridade da alta e a
+ *           média só roda depois, a espera fica em INV_CICLOS_BAIXA
+ * pingpong_fp o pingpong com as duas threads usando a FPU: cada troca salva e
+ *           restaura s16-s31 e o empilhamento preguiçoso de s0-s15
+ * pc_sem    o produtor/consumidor antigo da aplicação: buffer circular com
+ *           índices em módulo, um OSMutex e dois semáforos (vagas e itens);
+ *           ciclos entre dois itens recebidos, ops_per_sec são itens/s
+ * pc_spsc   o mesmo com o rtos::SpscRing de hoje, sem trava: as threads só
+ *           bloqueiam com o anel vazio ou cheio
+ * tick_N    ciclos do SysTick_Handler (OS_tick() e OS_sched()) com N threads
+ *           dormindo em OS_delay(), N = 2, 8 e 32; uma thread de carga gira
+ *           abaixo delas para o idle não rodar. TICK_OPS amostras, uma por tick
+ * preempt_N troca preemptiva entre duas threads (post até a alta rodar) com
+ *           N threads prontas, N = 8 e 64: as N - 2 de carga giram abaixo
+ *           do par e ocupam mais de um grupo do bitmap de prioridades
+ * trace     ciclos de um registro do trace do kernel (OS_TRACE), descontada a
+ *           leitura do DWT->CYCCNT; perto de 0 sem MIROS_TRACE
+ *
+ * switches são as trocas de contexto do benchmark, contadas pelo kernel: com
+ * MIROS_PROFILE, a soma de OSThread::switches das suas threads (vazia sem ele).
+ * As threads de todos os benchmarks são criadas no início e esperam o seu
+ * portão; quando o benchmark termina elas saem do laço e ficam paradas. As
+ * threads de carga de um benchmark ficam logo abaixo das suas, com stacks
+ * menores fora da CCM. São mais threads que o padrão de MIROS_MAX_PRIO:
+ * compile a suíte com MIROS_MAX_PRIO=160.
+ */
+
+#include "main.h"
+#include <algorithm>
+#include <cstdio>
+#include "miros.h"
+#include "miros_port.h"
+#include "miros_trace.h"
+#include "spsc_ring.h"
+#include "bench.h"
+
+#ifdef MIROS_BENCH
+
+// Operações medidas por benchmark; nos tick_N, uma por tick
+#define BENCH_OPS 1000U
+#define TICK_OPS 100U
+
+// Ticks que as threads dos tick_N dormem: bem mais que a suíte inteira
+#define TICK_ESPERA 60000U
+
+// Frequência da interrupção do benchmark jitter
+#define JITTER_HZ 20000U
+
+// Posições do buffer do pc_sem, como na aplicação antiga, e do anel do pc_spsc
+#define PC_SEM_POSICOES 10U
+#define PC_SPSC_POSICOES 16U
+
+// Ciclos da seção crítica da baixa e do trabalho da média nos inv_*
+#define INV_CICLOS_BAIXA 2000U
+#define INV_CICLOS_MEDIA 10000U
+
+enum {
+    B_COOP,
+    B_PREEMPT,
+    B_PINGPONG,
+    B_MSG,
+    B_ISR,
+    B_JITTER,
+    B_PC,
+    B_PC_LIMIAR,
+    B_INV_SEM,
+    B_INV_MUTEX,
+    B_PINGPONG_FP,
+    B_PC_SEM,
+    B_PC_SPSC,
+    B_TICK_2,
+    B_TICK_8,
+    B_TICK_32,
+    B_PREEMPT_8,
+    B_PREEMPT_64,
+    B_TRACE,
+    B_COUNT
+};
+
+static char const * const bench_nome[B_COUNT] = { "coop", "preempt", "pingpong", "msg", "isr", "jitter", "pc", "pc_limiar", "inv_sem", "inv_mutex", "pingpong_fp", "pc_sem", "pc_spsc", "tick_2", "tick_8", "tick_32", "preempt_8", "preempt_64", "trace" };
+
+// Threads de cada benchmark, liberadas juntas pelo portão com as de carga
+static uint8_t const bench_threads[B_COUNT] = { 2U, 5U, 2U, 2U, 2U, 2U, 2U, 2U, 3U, 3U, 2U, 2U, 2U, 1U, 1U, 1U, 2U, 2U, 1U };
+
+// Threads de carga: nos tick_N elas se somam às dos anteriores, 2 + 6 + 24 = 32;
+// nos preempt_N completam as N threads prontas
+static uint8_t const bench_carga[B_COUNT] = { 0U, 0U, 0U, 0U, 0U, 0U, 0U, 0U, 0U, 0U, 0U, 0U, 0U, 2U, 6U, 24U, 6U, 62U, 0U };
+
+// Amostras de cada benchmark
+static uint16_t const bench_ops[B_COUNT] = {
+    BENCH_OPS, BENCH_OPS, BENCH_OPS, BENCH_OPS, BENCH_OPS, BENCH_OPS, BENCH_OPS, BENCH_OPS,
+    BENCH_OPS, BENCH_OPS, BENCH_OPS, BENCH_OPS, BENCH_OPS, TICK_OPS, TICK_OPS, TICK_OPS,
+    BENCH_OPS, BENCH_OPS, BENCH_OPS
+};
+
+#define N_THREADS 39U
+#define N_CARGA 100U
+static_assert(MIROS_MAX_PRIO > (N_THREADS + N_CARGA), "compile a suíte com MIROS_MAX_PRIO=160");
+
+static rtos::OSSem portao[B_COUNT];
+static rtos::OSSem sem_fim;              // o benchmark colheu BENCH_OPS amostras
+static rtos::OSSem sem_parado;           // nunca sinalizado: prende as threads que terminaram
+static uint32_t volatile bench_atual = B_COUNT;
+
+static uint32_t amostras[BENCH_OPS];
+static uint32_t volatile n_amostras;
+static uint32_t volatile n_alvo;         // amostras do benchmark em curso
+static uint32_t volatile t0;             // DWT->CYCCNT no início da operação em curso
+static uint32_t t_inicio;
+static uint32_t t_fim;
+
+static void bench_amostra(uint32_t ciclos) {
+    if (n_amostras < n_alvo) {
+        amostras[n_amostras] = ciclos;
+        n_amostras = n_amostras + 1U;
+        if (n_amostras == n_alvo) {
+            t_fim = DWT->CYCCNT;
+            rtos::OSSem_post(&sem_fim);
+        }
+    }
+}
+
+static void bench_parar(void) {
+    while (1) {
+        (void)rtos::OSSem_pend(&sem_parado, rtos::OS_WAIT_FOREVER);
+    }
+}
+
+// coop: a alta bloqueia no semáforo e a baixa continua depois do post
+static rtos::OSSem sem_coop;
+
+static void coop_alta() {
+    (void)rtos::OSSem_pend(&portao[B_COOP], rtos::OS_WAIT_FOREVER);
+    while (bench_atual == B_COOP) {
+        t0 = DWT->CYCCNT;
+        (void)rtos::OSSem_pend(&sem_coop, rtos::OS_WAIT_FOREVER);
+    }
+    bench_parar();
+}
+
+static void coop_baixa() {
+    (void)rtos::OSSem_pend(&portao[B_COOP], rtos::OS_WAIT_FOREVER);
+    while (bench_atual == B_COOP) {
+        rtos::OSSem_post(&sem_coop);            // a alta roda e bloqueia de novo
+        bench_amostra(DWT->CYCCNT - t0);
+    }
+    bench_parar();
+}
+
+// preempt: cada post acorda a próxima thread da cadeia, mais prioritária
+static rtos::OSSem sem_preempt[5];
+
+template <uint32_t i>
+static void preempt_elo() {
+    (void)rtos::OSSem_pend(&portao[B_PREEMPT], rtos::OS_WAIT_FOREVER);
+    while (bench_atual == B_PREEMPT) {
+        if (i != 0U) {
+            (void)rtos::OSSem_pend(&sem_preempt[i], rtos::OS_WAIT_FOREVER);
+            bench_amostra(DWT->CYCCNT - t0);
+        }
+        if (i != 4U) {
+            t0 = DWT->CYCCNT;
+            rtos::OSSem_post(&sem_preempt[i + 1U]);
+        }
+    }
+    bench_parar();
+}
+
+// pingpong: a baixa sinaliza a alta e espera a resposta; no pingpong_fp as duas
+// fazem uma conta em ponto flutuante a cada volta, e o seu contexto passa a ter FPU
+static rtos::OSSem sem_ping[2];
+static rtos::OSSem sem_pong[2];
+static float volatile ping_fp;
+
+template <uint32_t b>
+static void ping_conta() {
+    if (b == B_PINGPONG_FP) {
+        ping_fp = ping_fp * 1.0001f;
+    }
+}
+
+template <uint32_t b>
+static void ping_alta() {
+    uint32_t const k = (b == B_PINGPONG_FP) ? 1U : 0U;
+    (void)rtos::OSSem_pend(&portao[b], rtos::OS_WAIT_FOREVER);
+    while (bench_atual == b) {
+        (void)rtos::OSSem_pend(&sem_ping[k], rtos::OS_WAIT_FOREVER);
+        ping_conta<b>();
+        rtos::OSSem_post(&sem_pong[k]);
+    }
+    bench_parar();
+}
+
+template <uint32_t b>
+static void ping_baixa() {
+    uint32_t const k = (b == B_PINGPONG_FP) ? 1U : 0U;
+    (void)rtos::OSSem_pend(&portao[b], rtos::OS_WAIT_FOREVER);
+    while (bench_atual == b) {
+        ping_conta<b>();
+        uint32_t inicio = DWT->CYCCNT;
+        rtos::OSSem_post(&sem_ping[k]);
+        (void)rtos::OSSem_pend(&sem_pong[k], rtos::OS_WAIT_FOREVER);
+        bench_amostra(DWT->CYCCNT - inicio);
+    }
+    bench_parar();
+}
+
+// msg: a mensagem é o instante do envio
+static void *fila_sto[4];
+static rtos::OSQueue fila;
+
+static void msg_recebe() {
+    (void)rtos::OSSem_pend(&portao[B_MSG], rtos::OS_WAIT_FOREVER);
+    while (bench_atual == B_MSG) {
+        void *msg;
+        if (rtos::OSQueue_get(&fila, &msg, rtos::OS_WAIT_FOREVER) == rtos::OS_OK) {
+            bench_amostra(DWT->CYCCNT - *static_cast<uint32_t *>(msg));
+        }
+    }
+    bench_parar();
+}
+
+static void msg_envia() {
+    static uint32_t enviado;
+
+    (void)rtos::OSSem_pend(&portao[B_MSG], rtos::OS_WAIT_FOREVER);
+    while (bench_atual == B_MSG) {
+        enviado = DWT->CYCCNT;
+        (void)rtos::OSQueue_post(&fila, &enviado, rtos::OS_WAIT_FOREVER);
+    }
+    bench_parar();
+}
+
+// isr: o TIM7 não é usado, a sua IRQ serve de interrupção por software
+static rtos::OSSem sem_isr;
+
+void TIM7_DAC_IRQHandler(void) {
+    rtos::OSSem_postFromISR(&sem_isr);
+}
+
+static void isr_alta() {
+    (void)rtos::OSSem_pend(&portao[B_ISR], rtos::OS_WAIT_FOREVER);
+    while (bench_atual == B_ISR) {
+        (void)rtos::OSSem_pend(&sem_isr, rtos::OS_WAIT_FOREVER);
+        bench_amostra(DWT->CYCCNT - t0);
+    }
+    bench_parar();
+}
+
+static void isr_baixa() {
+    (void)rtos::OSSem_pend(&portao[B_ISR], rtos::OS_WAIT_FOREVER);
+    while (bench_atual == B_ISR) {
+        t0 = DWT->CYCCNT;
+        NVIC_SetPendingIRQ(TIM7_DAC_IRQn);
+        __DSB();
+        __ISB();
+    }
+    bench_parar();
+}
+
+// jitter: o TIM2 fica acima de MIROS_SYSCALL_PRIO, então não pode chamar o kernel;
+// quem avisa o fim é a thread baixa, ao ver as amostras completas
+static rtos::OSSem sem_jping;
+static rtos::OSSem sem_jpong;
+static uint32_t volatile jitter_ultimo;
+static bool volatile jitter_primeira;
+
+void TIM2_IRQHandler(void) {
+    TIM2->SR = ~TIM_SR_UIF;
+    uint32_t agora = DWT->CYCCNT;
+    if (jitter_primeira) {
+        jitter_primeira = false;
+    } else if (n_amostras < n_alvo) {
+        amostras[n_amostras] = agora - jitter_ultimo;
+        n_amostras = n_amostras + 1U;
+        if (n_amostras == n_alvo) {
+            t_fim = agora;
+        }
+    }
+    jitter_ultimo = agora;
+}
+
+static void jitter_alta() {
+    (void)rtos::OSSem_pend(&portao[B_JITTER], rtos::OS_WAIT_FOREVER);
+    while (bench_atual == B_JITTER) {
+        (void)rtos::OSSem_pend(&sem_jping, rtos::OS_WAIT_FOREVER);
+        rtos::OSSem_post(&sem_jpong);
+    }
+    bench_parar();
+}
+
+static void jitter_baixa() {
+    (void)rtos::OSSem_pend(&portao[B_JITTER], rtos::OS_WAIT_FOREVER);
+    jitter_primeira = true;
+    TIM2->CNT = 0U;
+    TIM2->CR1 |= TIM_CR1_CEN;
+    while (n_amostras < n_alvo) {
+        rtos::OSSem_post(&sem_jping);
+        (void)rtos::OSSem_pend(&sem_jpong, rtos::OS_WAIT_FOREVER);
+    }
+    TIM2->CR1 &= ~TIM_CR1_CEN;
+    rtos::OSSem_post(&sem_fim);
+    rtos::OSSem_post(&sem_jping);               // solta a alta para ela sair do laço
+    bench_parar();
+}
+
+// pc: uma fila por benchmark, para as mensagens que sobram de um não irem para o outro
+static void *pc_fila_sto[2][4];
+static rtos::OSQueue pc_fila[2];
+
+template <uint32_t b>
+static void pc_produtor() {
+    static uint32_t enviado;
+
+    (void)rtos::OSSem_pend(&portao[b], rtos::OS_WAIT_FOREVER);
+    while (bench_atual == b) {
+        (void)rtos::OSQueue_post(&pc_fila[b - B_PC], &enviado, rtos::OS_WAIT_FOREVER);
+    }
+    bench_parar();
+}
+
+template <uint32_t b>
+static void pc_consumidor() {
+    (void)rtos::OSSem_pend(&portao[b], rtos::OS_WAIT_FOREVER);
+    uint32_t anterior = DWT->CYCCNT;
+    while (bench_atual == b) {
+        void *msg;
+        if (rtos::OSQueue_get(&pc_fila[b - B_PC], &msg, rtos::OS_WAIT_FOREVER) == rtos::OS_OK) {
+            uint32_t agora = DWT->CYCCNT;
+            bench_amostra(agora - anterior);
+            anterior = agora;
+        }
+    }
+    bench_parar();
+}
+
+// inv: a mesma sequência com as duas travas, sem herança e com herança
+static rtos::OSSem inv_sem;
+static rtos::OSMutex inv_mutex;
+static rtos::OSSem inv_vai_alta[2];
+static rtos::OSSem inv_vai_media[2];
+
+template <uint32_t b>
+static void inv_trava() {
+    if (b == B_INV_MUTEX) {
+        rtos::OSMutex_lock(&inv_mutex);
+    } else {
+        (void)rtos::OSSem_pend(&inv_sem, rtos::OS_WAIT_FOREVER);
+    }
+}
+
+template <uint32_t b>
+static void inv_solta() {
+    if (b == B_INV_MUTEX) {
+        rtos::OSMutex_unlock(&inv_mutex);
+    } else {
+        rtos::OSSem_post(&inv_sem);
+    }
+}
+
+static void inv_ocupa(uint32_t ciclos) {
+    uint32_t inicio = DWT->CYCCNT;
+    while ((DWT->CYCCNT - inicio) < ciclos) {
+    }
+}
+
+template <uint32_t b>
+static void inv_baixa() {
+    (void)rtos::OSSem_pend(&portao[b], rtos::OS_WAIT_FOREVER);
+    while (bench_atual == b) {
+        inv_trava<b>();
+        rtos::OSSem_post(&inv_vai_alta[b - B_INV_SEM]);     // a alta roda e bloqueia na trava
+        rtos::OSSem_post(&inv_vai_media[b - B_INV_SEM]);    // sem herança a média roda aqui
+        inv_ocupa(INV_CICLOS_BAIXA);
+        inv_solta<b>();                                     // a alta pega a trava
+    }
+    bench_parar();
+}
+
+template <uint32_t b>
+static void inv_media() {
+    (void)rtos::OSSem_pend(&portao[b], rtos::OS_WAIT_FOREVER);
+    while (bench_atual == b) {
+        (void)rtos::OSSem_pend(&inv_vai_media[b - B_INV_SEM], rtos::OS_WAIT_FOREVER);
+        inv_ocupa(INV_CICLOS_MEDIA);
+    }
+    bench_parar();
+}
+
+template <uint32_t b>
+static void inv_alta() {
+    (void)rtos::OSSem_pend(&portao[b], rtos::OS_WAIT_FOREVER);
+    while (bench_atual == b) {
+        (void)rtos::OSSem_pend(&inv_vai_alta[b - B_INV_SEM], rtos::OS_WAIT_FOREVER);
+        uint32_t inicio = DWT->CYCCNT;
+        inv_trava<b>();
+        bench_amostra(DWT->CYCCNT - inicio);
+        inv_solta<b>();
+    }
+    bench_parar();
+}
+
+// pc_sem: produtor baixo e consumidor alto, cada item passa por pend, trava,
+// destrava e post dos dois lados
+static uint32_t pcs_buffer[PC_SEM_POSICOES];
+static uint32_t pcs_cabeca;
+static uint32_t pcs_cauda;
+static uint32_t pcs_ocupadas;
+static rtos::OSMutex pcs_mutex;
+static rtos::OSSem pcs_vagas;
+static rtos::OSSem pcs_itens;
+
+static void pcs_produtor() {
+    uint32_t codigo = 1U;
+
+    (void)rtos::OSSem_pend(&portao[B_PC_SEM], rtos::OS_WAIT_FOREVER);
+    while (bench_atual == B_PC_SEM) {
+        (void)rtos::OSSem_pend(&pcs_vagas, rtos::OS_WAIT_FOREVER);
+        rtos::OSMutex_lock(&pcs_mutex);
+        pcs_buffer[pcs_cauda] = codigo;
+        pcs_cauda = (pcs_cauda + 1U) % PC_SEM_POSICOES;
+        pcs_ocupadas++;
+        rtos::OSMutex_unlock(&pcs_mutex);
+        rtos::OSSem_post(&pcs_itens);
+        codigo++;
+    }
+    bench_parar();
+}
+
+static void pcs_consumidor() {
+    (void)rtos::OSSem_pend(&portao[B_PC_SEM], rtos::OS_WAIT_FOREVER);
+    uint32_t anterior = DWT->CYCCNT;
+    while (bench_atual == B_PC_SEM) {
+        (void)rtos::OSSem_pend(&pcs_itens, rtos::OS_WAIT_FOREVER);
+        rtos::OSMutex_lock(&pcs_mutex);
+        uint32_t volatile codigo = pcs_buffer[pcs_cabeca];
+        (void)codigo;
+        pcs_cabeca = (pcs_cabeca + 1U) % PC_SEM_POSICOES;
+        pcs_ocupadas--;
+        rtos::OSMutex_unlock(&pcs_mutex);
+        rtos::OSSem_post(&pcs_vagas);
+
+        uint32_t agora = DWT->CYCCNT;
+        bench_amostra(agora - anterior);
+        anterior = agora;
+    }
+    bench_parar();
+}
+
+// pc_spsc: as mesmas threads sobre o anel
+static rtos::SpscRing<uint32_t, PC_SPSC_POSICOES> pc_anel;
+
+static void spsc_produtor() {
+    uint32_t codigo = 1U;
+
+    (void)rtos::OSSem_pend(&portao[B_PC_SPSC], rtos::OS_WAIT_FOREVER);
+    while (bench_atual == B_PC_SPSC) {
+        pc_anel.push(codigo);
+        codigo++;
+    }
+    bench_parar();
+}
+
+static void spsc_consumidor() {
+    (void)rtos::OSSem_pend(&portao[B_PC_SPSC], rtos::OS_WAIT_FOREVER);
+    uint32_t anterior = DWT->CYCCNT;
+    while (bench_atual == B_PC_SPSC) {
+        uint32_t volatile codigo = pc_anel.pop();
+        (void)codigo;
+
+        uint32_t agora = DWT->CYCCNT;
+        bench_amostra(agora - anterior);
+        anterior = agora;
+    }
+    bench_parar();
+}
+
+// tick_N: o SysTick_Handler entrega os seus ciclos a bench_tick()
+void bench_tick(uint32_t ciclos) {
+    if ((bench_atual >= B_TICK_2) && (bench_atual <= B_TICK_32)) {
+        bench_amostra(ciclos);
+    }
+}
+
+// gira enquanto o benchmark b roda: sempre pronta, abaixo das threads que medem
+template <uint32_t b>
+static void gira() {
+    (void)rtos::OSSem_pend(&portao[b], rtos::OS_WAIT_FOREVER);
+    while (bench_atual == b) {
+    }
+    bench_parar();
+}
+
+// carga dos tick_N: cada thread dorme um tempo diferente, uma entrada a mais na lista
+static uint32_t volatile tick_dormindo;
+
+template <uint32_t b>
+static void tick_dorme() {
+    (void)rtos::OSSem_pend(&portao[b], rtos::OS_WAIT_FOREVER);
+    tick_dormindo = tick_dormindo + 1U;
+    rtos::OS_delay(TICK_ESPERA + tick_dormindo);
+    bench_parar();
+}
+
+// preempt_N: como o preempt, mas um só post entre duas threads
+static rtos::OSSem sem_preempt_n[2];
+
+template <uint32_t b>
+static void preempt_n_baixa() {
+    (void)rtos::OSSem_pend(&portao[b], rtos::OS_WAIT_FOREVER);
+    while (bench_atual == b) {
+        t0 = DWT->CYCCNT;
+        rtos::OSSem_post(&sem_preempt_n[b - B_PREEMPT_8]);
+    }
+    bench_parar();
+}
+
+template <uint32_t b>
+static void preempt_n_alta() {
+    (void)rtos::OSSem_pend(&portao[b], rtos::OS_WAIT_FOREVER);
+    while (bench_atual == b) {
+        (void)rtos::OSSem_pend(&sem_preempt_n[b - B_PREEMPT_8], rtos::OS_WAIT_FOREVER);
+        bench_amostra(DWT->CYCCNT - t0);
+    }
+    bench_parar();
+}
+
+// trace: um registro por amostra, o que o kernel grava a cada evento
+static void trace_registra() {
+    (void)rtos::OSSem_pend(&portao[B_TRACE], rtos::OS_WAIT_FOREVER);
+    uint32_t inicio = DWT->CYCCNT;
+    uint32_t const leitura = DWT->CYCCNT - inicio;
+    while (bench_atual == B_TRACE) {
+        inicio = DWT->CYCCNT;
+        OS_TRACE(rtos::OS_EVT_CALIB, 2U, 0U);
+        uint32_t const ciclos = DWT->CYCCNT - inicio;
+        bench_amostra((ciclos > leitura) ? (ciclos - leitura) : 0U);
+    }
+    bench_parar();
+}
+
+static uint32_t pilha_controle[512] OS_CCM_DATA;
+static rtos::OSThread thread_controle;
+
+static uint32_t pilhas[N_THREADS][128] OS_CCM_DATA;
+static uint32_t pilhas_carga[N_CARGA][64];
+static rtos::OSThread threads[N_THREADS + N_CARGA];
+
+#ifdef MIROS_PROFILE
+// Vezes em que as threads do benchmark b entraram na CPU; as threads estão
+// em threads[] na ordem dos benchmarks, as de carga antes das outras
+static uint32_t bench_trocas(uint32_t b) {
+    uint32_t primeira = 0U;
+    for (uint32_t i = 0U; i < b; i++) {
+        primeira += bench_carga[i] + bench_threads[i];
+    }
+    uint32_t soma = 0U;
+    for (uint32_t i = primeira; i < (primeira + bench_carga[b] + bench_threads[b]); i++) {
+        soma += threads[i].switches;
+    }
+    return soma;
+}
+#endif
+
+static void bench_imprime(uint32_t b, uint32_t trocas) {
+    uint32_t const n = bench_ops[b];
+    uint64_t soma = 0U;
+    for (uint32_t i = 0U; i < n; i++) {
+        soma += amostras[i];
+    }
+    std::sort(&amostras[0], &amostras[n]);
+
+    uint64_t ops_s = ((uint64_t)n * SystemCoreClock) / (uint32_t)(t_fim - t_inicio);
+    printf("%s,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,", bench_nome[b], (unsigned long)n,
+        (unsigned long)ops_s, (unsigned long)(soma / n), (unsigned long)amostras[0],
+        (unsigned long)amostras[n / 2U], (unsigned long)amostras[(n * 90U) / 100U],
+        (unsigned long)amostras[(n * 99U) / 100U], (unsigned long)amostras[n - 1U]);
+#ifdef MIROS_PROFILE
+    printf("%lu", (unsigned long)trocas);
+#else
+    (void)trocas;
+#endif
+    printf("\n");
+}
+
+// Controlador, acima de todas as threads dos benchmarks
+static void bench_controle() {
+    console_init();
+    printf("bench,ops,ops_per_sec,mean,min,p50,p90,p99,max,switches\n");
+
+    for (uint32_t b = 0U; b < B_COUNT; b++) {
+        n_amostras = 0U;
+        n_alvo = bench_ops[b];
+        bench_atual = b;
+        t_inicio = DWT->CYCCNT;
+        uint32_t trocas = 0U;
+#ifdef MIROS_PROFILE
+        trocas = bench_trocas(b);
+#endif
+        for (uint8_t n = 0U; n < (bench_carga[b] + bench_threads[b]); n++) {
+            rtos::OSSem_post(&portao[b]);
+        }
+        (void)rtos::OSSem_pend(&sem_fim, rtos::OS_WAIT_FOREVER);
+
+        bench_atual = B_COUNT;                  // as threads saem do laço e param
+#ifdef MIROS_PROFILE
+        trocas = bench_trocas(b) - trocas;
+#endif
+        bench_imprime(b, trocas);
+    }
+    bench_parar();
+}
+
+void bench_start(void) {
+    // Contador de ciclos do DWT
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0U;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    for (uint32_t b = 0U; b < B_COUNT; b++) {
+        rtos::OSSem_init(&portao[b], 0U);
+    }
+    rtos::OSSem_init(&sem_fim, 0U);
+    rtos::OSSem_init(&sem_parado, 0U);
+    rtos::OSSem_init(&sem_coop, 0U);
+    for (uint32_t i = 0U; i < 5U; i++) {
+        rtos::OSSem_init(&sem_preempt[i], 0U);
+    }
+    for (uint32_t i = 0U; i < 2U; i++) {
+        rtos::OSSem_init(&sem_ping[i], 0U);
+        rtos::OSSem_init(&sem_pong[i], 0U);
+    }
+    rtos::OSQueue_init(&fila, fila_sto, 4U);
+    rtos::OSSem_init(&sem_isr, 0U);
+    rtos::OSSem_init(&sem_jping, 0U);
+    rtos::OSSem_init(&sem_jpong, 0U);
+    rtos::OSQueue_init(&pc_fila[0], pc_fila_sto[0], 4U);
+    rtos::OSQueue_init(&pc_fila[1], pc_fila_sto[1], 4U);
+    rtos::OSSem_init(&sem_preempt_n[0], 0U);
+    rtos::OSSem_init(&sem_preempt_n[1], 0U);
+    rtos::OSMutex_init(&pcs_mutex);
+    rtos::OSSem_init(&pcs_vagas, PC_SEM_POSICOES);
+    rtos::OSSem_init(&pcs_itens, 0U);
+    rtos::OSSem_init(&inv_sem, 1U);
+    rtos::OSMutex_init(&inv_mutex);
+    for (uint32_t i = 0U; i < 2U; i++) {
+        rtos::OSSem_init(&inv_vai_alta[i], 0U);
+        rtos::OSSem_init(&inv_vai_media[i], 0U);
+    }
+
+    // Prioridades únicas: cada benchmark acima do anterior, o controlador acima de todos
+    static rtos::OSThreadHandler const corpos[N_THREADS] = {
+        &coop_baixa, &coop_alta,
+        &preempt_elo<0U>, &preempt_elo<1U>, &preempt_elo<2U>, &preempt_elo<3U>, &preempt_elo<4U>,
+        &ping_baixa<B_PINGPONG>, &ping_alta<B_PINGPONG>,
+        &msg_envia, &msg_recebe,
+        &isr_baixa, &isr_alta,
+        &jitter_baixa, &jitter_alta,
+        &pc_produtor<B_PC>, &pc_consumidor<B_PC>,
+        &pc_produtor<B_PC_LIMIAR>, &pc_consumidor<B_PC_LIMIAR>,
+        &inv_baixa<B_INV_SEM>, &inv_media<B_INV_SEM>, &inv_alta<B_INV_SEM>,
+        &inv_baixa<B_INV_MUTEX>, &inv_media<B_INV_MUTEX>, &inv_alta<B_INV_MUTEX>,
+        &ping_baixa<B_PINGPONG_FP>, &ping_alta<B_PINGPONG_FP>,
+        &pcs_produtor, &pcs_consumidor,
+        &spsc_produtor, &spsc_consumidor,
+        &gira<B_TICK_2>,
+        &gira<B_TICK_8>,
+        &gira<B_TICK_32>,
+        &preempt_n_baixa<B_PREEMPT_8>, &preempt_n_alta<B_PREEMPT_8>,
+        &preempt_n_baixa<B_PREEMPT_64>, &preempt_n_alta<B_PREEMPT_64>,
+        &trace_registra
+    };
+    static rtos::OSThreadHandler const corpos_carga[B_COUNT] = {
+        nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+        nullptr, nullptr, nullptr, nullptr, nullptr,
+        &tick_dorme<B_TICK_2>, &tick_dorme<B_TICK_8>, &tick_dorme<B_TICK_32>,
+        &gira<B_PREEMPT_8>, &gira<B_PREEMPT_64>, nullptr
+    };
+    uint16_t prio = 1U;
+    uint32_t medida = 0U;
+    uint32_t carga = 0U;
+    for (uint32_t b = 0U; b < B_COUNT; b++) {
+        for (uint8_t n = 0U; n < bench_carga[b]; n++, carga++, prio++) {
+            rtos::OSThread_start(&threads[prio - 1U], prio, corpos_carga[b], pilhas_carga[carga], sizeof(pilhas_carga[carga]));
+        }
+        for (uint8_t n = 0U; n < bench_threads[b]; n++, medida++, prio++) {
+            rtos::OSThread_start(&threads[prio - 1U], prio, corpos[medida], pilhas[medida], sizeof(pilhas[medida]));
+        }
+    }
+
+    // Limiar do produtor do pc_limiar (prioridade 18) na prioridade do seu consumidor (19)
+    rtos::OSThread_setThreshold(&threads[17], 19U);
+    rtos::OSThread_start(&thread_controle, prio, &bench_controle, pilha_controle, sizeof(pilha_controle));
+
+    // IRQ que chama o kernel: no máximo tão urgente quanto MIROS_SYSCALL_PRIO
+    HAL_NVIC_SetPriority(TIM7_DAC_IRQn, MIROS_SYSCALL_PRIO, 0U);
+    HAL_NVIC_EnableIRQ(TIM7_DAC_IRQn);
+
+    // TIM2 parado até o benchmark jitter, na prioridade 0: nunca mascarado pelo kernel
+    __HAL_RCC_TIM2_CLK_ENABLE();
+    TIM2->PSC = 0U;
+    TIM2->ARR = (SystemCoreClock / JITTER_HZ) - 1U;
+    TIM2->EGR = TIM_EGR_UG;
+    TIM2->SR = 0U;
+    TIM2->DIER = TIM_DIER_UIE;
+    HAL_NVIC_SetPriority(TIM2_IRQn, 0U, 0U);
+    HAL_NVIC_EnableIRQ(TIM2_IRQn);
+}
+
+#endif
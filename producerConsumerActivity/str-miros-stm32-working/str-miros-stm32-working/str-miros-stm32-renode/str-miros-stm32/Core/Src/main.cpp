@@ -1,24 +1,151 @@
 #include "main.h"
+#include <cstdio>
 #include "miros.h"
+#include "miros_port.h"
+#include "miros_static.h"
+#include "bench.h"
 
-// Stack da thread blink
-uint32_t pilha_blink[80];
-rtos::OSThread thread_blink;
+// Semáforo sinalizado pelo timer sinal e aguardado pela thread blink
+rtos::OSSem sem_blink;
 
-// Função da thread
+#ifdef MIROS_PROFILE
+// Latência de despertar (ciclos entre o post e a thread blink voltar a rodar)
+uint32_t volatile t_post;
+uint32_t volatile latencia_ultima;
+uint32_t volatile latencia_max;
+#endif
+
+// Timer sinal: roda no daemon de timers, sem precisar de stack própria
+rtos::OSTimer timer_sinal;
+
+// Stack do daemon de timers (compartilhada por todos os timers)
+uint32_t pilha_timers[80] OS_CCM_DATA;
+
+// Função da thread blink: pisca o LED a cada sinal recebido
 void funcao_blink() {
     while (1) {
-        HAL_GPIO_TogglePin(GPIOA, GPIO_PIN_5);  // LED LD2
-        rtos::OS_delay(500);                    // espera 500 ms
+        if (rtos::OSSem_pend(&sem_blink, 2U * rtos::TICKS_PER_SEC) == rtos::OS_OK) {
+#ifdef MIROS_PROFILE
+            latencia_ultima = DWT->CYCCNT - t_post;
+            if (latencia_ultima > latencia_max) {
+                latencia_max = latencia_ultima;
+            }
+#endif
+            HAL_GPIO_TogglePin(GPIOA, GPIO_PIN_5);  // LED LD2
+        }
+    }
+}
+
+// Thread blink montada em tempo de compilação: stack, TCB e contexto inicial
+// (na CCM SRAM com -DMIROS_CCM)
+constinit rtos::Thread<80U, 2U, &funcao_blink> thread_blink OS_CCM_INIT;
+
+// Botão B1 (PC13): o post vem da interrupção, a troca acontece na saída dela
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin) {
+    if (GPIO_Pin == GPIO_PIN_13) {
+#ifdef MIROS_PROFILE
+        t_post = DWT->CYCCNT;
+#endif
+        rtos::OSSem_postFromISR(&sem_blink);
+    }
+}
+
+// Callback do timer sinal: libera a thread blink a cada 500 ms
+void funcao_sinal(void *arg) {
+#ifdef MIROS_PROFILE
+    t_post = DWT->CYCCNT;
+#endif
+    rtos::OSSem_post(static_cast<rtos::OSSem *>(arg));
+}
+
+#if defined(MIROS_PROFILE) || defined(MIROS_BENCH)
+// USART2 TX em PA2, 115200 8N1, por polling; o printf chega aqui pelo _write do syscalls.c
+void console_init(void) {
+    RCC->AHB2ENR |= RCC_AHB2ENR_GPIOAEN;
+    RCC->APB1ENR1 |= RCC_APB1ENR1_USART2EN;
+    GPIOA->AFR[0] = (GPIOA->AFR[0] & ~GPIO_AFRL_AFSEL2) | (7U << GPIO_AFRL_AFSEL2_Pos);
+    GPIOA->MODER = (GPIOA->MODER & ~GPIO_MODER_MODE2) | GPIO_MODER_MODE2_1;
+    USART2->BRR = HAL_RCC_GetPCLK1Freq() / 115200U;
+    USART2->CR1 = USART_CR1_TE | USART_CR1_UE;
+}
+
+extern "C" int __io_putchar(int ch) {
+    while ((USART2->ISR & USART_ISR_TXE_TXFNF) == 0U) {
     }
+    USART2->TDR = (uint8_t)ch;
+    return ch;
 }
+#endif
+
+#ifdef MIROS_PROFILE
+// Thread monitor: imprime o tempo de boot e depois as estatísticas de todas
+// as threads a cada 5 s
+void funcao_monitor() {
+    rtos::OSThreadStats stats[4];
+    uint64_t lastWake = rtos::OS_getTicks();
+
+    console_init();
+    printf("\r\nboot ate a primeira thread: %lu ciclos\r\n", (unsigned long)rtos::OS_bootCycles);
+    while (1) {
+        rtos::OS_delayUntil(&lastWake, 5U * rtos::TICKS_PER_SEC);
+
+        uint16_t n = rtos::OS_getStats(stats, 4U);
+        printf("\r\nprio  switches  max resp [cyc]  runtime [ms]     CPU\r\n");
+        for (uint16_t i = 0U; i < n; i++) {
+            printf("%4u  %8lu  %14lu  %12lu  %3u.%02u%%\r\n", stats[i].thread->basePrio,
+                (unsigned long)stats[i].switches, (unsigned long)stats[i].maxResponse,
+                (unsigned long)(stats[i].runCycles / (SystemCoreClock / 1000U)), stats[i].cpu / 100U, stats[i].cpu % 100U);
+        }
+    }
+}
+
+constinit rtos::Thread<256U, 1U, &funcao_monitor> thread_monitor OS_CCM_INIT;
+#endif
 
 // Idle stack
-uint32_t pilha_idle[40];
+uint32_t pilha_idle[40] OS_CCM_DATA;
+
+// Configura clock do sistema (HSI + PLL)
+static void SystemClock_Config(void) {
+  RCC_OscInitTypeDef RCC_OscInitStruct = {0};
+  RCC_ClkInitTypeDef RCC_ClkInitStruct = {0};
+
+  HAL_PWREx_ControlVoltageScaling(PWR_REGULATOR_VOLTAGE_SCALE1_BOOST);
+
+  RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_HSI;
+  RCC_OscInitStruct.HSIState = RCC_HSI_ON;
+  RCC_OscInitStruct.HSICalibrationValue = RCC_HSICALIBRATION_DEFAULT;
+  RCC_OscInitStruct.PLL.PLLState = RCC_PLL_ON;
+  RCC_OscInitStruct.PLL.PLLSource = RCC_PLLSOURCE_HSI;
+  RCC_OscInitStruct.PLL.PLLM = RCC_PLLM_DIV4;
+  RCC_OscInitStruct.PLL.PLLN = 85;
+  RCC_OscInitStruct.PLL.PLLP = RCC_PLLP_DIV2;
+  RCC_OscInitStruct.PLL.PLLQ = RCC_PLLQ_DIV2;
+  RCC_OscInitStruct.PLL.PLLR = RCC_PLLR_DIV2;
+  HAL_RCC_OscConfig(&RCC_OscInitStruct);
+
+  RCC_ClkInitStruct.ClockType = RCC_CLOCKTYPE_HCLK|RCC_CLOCKTYPE_SYSCLK |
+                                RCC_CLOCKTYPE_PCLK1|RCC_CLOCKTYPE_PCLK2;
+  RCC_ClkInitStruct.SYSCLKSource = RCC_SYSCLKSOURCE_PLLCLK;
+  RCC_ClkInitStruct.AHBCLKDivider = RCC_SYSCLK_DIV1;
+  RCC_ClkInitStruct.APB1CLKDivider = RCC_HCLK_DIV1;
+  RCC_ClkInitStruct.APB2CLKDivider = RCC_HCLK_DIV1;
+  HAL_RCC_ClockConfig(&RCC_ClkInitStruct, FLASH_LATENCY_4);
+}
 
 int main(void) {
     HAL_Init();
 
+    // Clock do sistema (o kernel só lê SystemCoreClock)
+    SystemClock_Config();
+
+#ifdef MIROS_BENCH
+    // Só a suíte de benchmarks, sem a aplicação
+    rtos::OS_init(pilha_idle, sizeof(pilha_idle));
+    bench_start();
+    rtos::OS_run();
+#endif
+
     // Clock de GPIOA
     __HAL_RCC_GPIOA_CLK_ENABLE();
 
@@ -30,11 +157,35 @@ int main(void) {
     gpio.Speed = GPIO_SPEED_FREQ_LOW;
     HAL_GPIO_Init(GPIOA, &gpio);
 
+    // Configura o botão B1 (PC13) com interrupção na borda de subida
+    __HAL_RCC_GPIOC_CLK_ENABLE();
+    gpio.Pin = GPIO_PIN_13;
+    gpio.Mode = GPIO_MODE_IT_RISING;
+    gpio.Pull = GPIO_NOPULL;
+    HAL_GPIO_Init(GPIOC, &gpio);
+    // A interrupção chama o kernel: no máximo tão urgente quanto MIROS_SYSCALL_PRIO
+    HAL_NVIC_SetPriority(EXTI15_10_IRQn, MIROS_SYSCALL_PRIO, 0U);
+
     // Inicializa o RTOS e idle
     rtos::OS_init(pilha_idle, sizeof(pilha_idle));
 
-    // Cria a thread blink
-    rtos::OSThread_start(&thread_blink, &funcao_blink, pilha_blink, sizeof(pilha_blink));
+    rtos::OSSem_init(&sem_blink, 0U);
+
+    // Daemon de timers com a maior prioridade e o timer periódico de 500 ms
+    rtos::OS_timerInit(3U, pilha_timers, sizeof(pilha_timers));
+    rtos::OSTimer_init(&timer_sinal, &funcao_sinal, &sem_blink);
+    rtos::OSTimer_start(&timer_sinal, rtos::TICKS_PER_SEC / 2U, rtos::TICKS_PER_SEC / 2U);
+
+    // Libera a thread blink e, com MIROS_PROFILE, o monitor abaixo dela
+    // (prioridades únicas, maior número = mais prioritária; o compilador confere)
+#ifdef MIROS_PROFILE
+    rtos::OS_startStatic(thread_blink, thread_monitor);
+#else
+    rtos::OS_startStatic(thread_blink);
+#endif
+
+    // Habilita o botão só depois que o semáforo e as threads existem
+    HAL_NVIC_EnableIRQ(EXTI15_10_IRQn);
 
     // Inicia o escalonador (não retorna)
     rtos::OS_run();
@@ -22,6 +22,9 @@
 #include "stm32g4xx_it.h"
 
 #include "miros.h"
+#include "miros_port.h"
+#include "miros_trace.h"
+#include "bench.h"
 
 /******************************************************************************/
 /*           Cortex-M4 Processor Interruption and Exception Handlers          */
@@ -107,13 +110,21 @@ void DebugMon_Handler(void)
 /**
   * @brief This function handles System tick timer.
   */
-void SysTick_Handler(void)
+OS_CCM_CODE void SysTick_Handler(void)
 {
+  OS_TRACE_ISR_ENTER();
+#ifdef MIROS_BENCH
+  uint32_t bench_t0 = DWT->CYCCNT;
+#endif
   HAL_IncTick();
   rtos::OS_tick();
-  __disable_irq();
+  uint32_t crit = rtos::OS_critEnter();
   rtos::OS_sched();
-  __enable_irq();
+  rtos::OS_critExit(crit);
+#ifdef MIROS_BENCH
+  bench_tick(DWT->CYCCNT - bench_t0);
+#endif
+  OS_TRACE_ISR_EXIT();
 }
 
 /******************************************************************************/
@@ -123,6 +134,16 @@ void SysTick_Handler(void)
 /* please refer to the startup file (startup_stm32g4xx.s).                    */
 /******************************************************************************/
 
+/**
+  * @brief This function handles EXTI line[15:10] interrupts (user button B1 on PC13).
+  */
+void EXTI15_10_IRQHandler(void)
+{
+  OS_TRACE_ISR_ENTER();
+  HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_13);
+  OS_TRACE_ISR_EXIT();
+}
+
 /* USER CODE BEGIN 1 */
 const uint32_t SRAM_START=0x20000000U;
 const uint32_t SRAM_SIZE = (128U * 1024U); // 128KB
@@ -181,7 +202,6 @@ void SPI2_IRQHandler(void) __attribute__((weak, alias("Default_Handler")));
 void USART1_IRQHandler(void) __attribute__((weak, alias("Default_Handler")));
 void USART2_IRQHandler(void) __attribute__((weak, alias("Default_Handler")));
 void USART3_IRQHandler(void) __attribute__((weak, alias("Default_Handler")));
-void EXTI15_10_IRQHandler(void) __attribute__((weak, alias("Default_Handler")));
 void RTC_Alarm_IRQHandler(void) __attribute__((weak, alias("Default_Handler")));
 void USBWakeUp_IRQHandler(void) __attribute__((weak, alias("Default_Handler")));
 void TIM8_BRK_IRQHandler(void) __attribute__((weak, alias("Default_Handler")));
@@ -0,0 +1,18 @@
+# Roda a suíte de benchmarks no Renode e guarda o CSV com o commit atual:
+#   ./bench.sh                      -> bench/<commit>.csv
+#   ./bench.sh bench/<outro>.csv    -> também compara com um resultado anterior
+# O ELF em Debug/ precisa ter sido compilado com MIROS_BENCH definido.
+cd "$(dirname "$0")"
+rev=$(git rev-parse --short HEAD)
+# o kernel vem da árvore principal (../../../../str-miros-stm32/Core)
+git diff --quiet HEAD -- . ../../../../str-miros-stm32/Core || rev="$rev-dirty"
+
+mkdir -p bench
+csv="$PWD/bench/$rev.csv"
+rm -f "$csv"
+renode --disable-xwt --console --plain -e "\$csv=@$csv; \$profile=@$PWD/bench/$rev-metrics.dump; include @$PWD/bench.resc"
+
+cat "$csv"
+if [ -n "$1" ]; then
+    python3 bench_compare.py "$1" "$csv"
+fi
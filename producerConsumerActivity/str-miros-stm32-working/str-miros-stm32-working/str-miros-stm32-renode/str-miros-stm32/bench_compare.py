@@ -0,0 +1,30 @@
+# Compara dois CSVs da suíte de benchmarks (bench.sh):
+#   python3 bench_compare.py antes.csv depois.csv
+import csv
+import sys
+
+
+def load(path):
+    with open(path, newline='') as f:
+        return {row['bench']: row for row in csv.DictReader(f)}
+
+
+before = load(sys.argv[1])
+after = load(sys.argv[2])
+cols = ['ops_per_sec', 'mean', 'p50', 'p99', 'max', 'switches']
+
+print('%-10s' % 'bench' + ''.join('%22s' % c for c in cols))
+for name, row in after.items():
+    if name not in before:
+        continue
+    line = '%-10s' % name
+    for c in cols:
+        # switches só existe nos builds com MIROS_PROFILE
+        if not before[name].get(c) or not row.get(c):
+            line += '%22s' % '-'
+            continue
+        a = float(before[name][c])
+        b = float(row[c])
+        delta = (b - a) * 100.0 / a if a != 0 else 0.0
+        line += '%13d (%+6.1f%%)' % (b, delta)
+    print(line)
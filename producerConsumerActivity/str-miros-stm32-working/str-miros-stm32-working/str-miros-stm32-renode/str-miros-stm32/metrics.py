@@ -6,6 +6,7 @@ sys.path.append(str(Path(get_default_renode_path()).parent))
 from renode_colab_tools import metrics
 from tools.metrics_analyzer.metrics_parser import MetricsParser
 #metrics.init_notebook_mode(connected=False)
-parser = MetricsParser('metrics.dump')
+# python3 metrics.py [dump], ex.: bench/<commit>-metrics.dump da suíte de benchmarks
+parser = MetricsParser(sys.argv[1] if len(sys.argv) > 1 else 'metrics.dump')
 
 metrics.display_metrics(parser)
@@ -9,23 +9,90 @@
 #define INC_MIROS_H_
 
 namespace rtos {
-	/* Thread Control Block (TCB) */
+	struct OSMutex;
+	struct OSSharedStack;
+
+	typedef void (*OSThreadHandler)();
+
+	/* outcome of the blocking calls that take a timeout */
+	typedef enum {
+		OS_OK, /* the call completed */
+		OS_TIMEOUT /* the timeout expired first */
+	} OSStatus;
+
+	/* timeout value that waits without a time limit */
+	const uint32_t OS_WAIT_FOREVER = 0U;
+
+	/* highest thread priority (1..1024), one thread per priority;
+	* build with -DMIROS_MAX_PRIO=<n> to go beyond 32 threads
+	*/
+#ifndef MIROS_MAX_PRIO
+#define MIROS_MAX_PRIO 32U
+#endif
+	static_assert((MIROS_MAX_PRIO >= 1U) && (MIROS_MAX_PRIO <= 1024U), "MIROS_MAX_PRIO out of range");
+
+	/* set of priorities as a two-level bitmap: bit n of groups tells that
+	* bits[n] (priorities 32n+1..32n+32) is not empty, so the highest
+	* priority is found with two CLZ instructions
+	*/
 	typedef struct {
+		uint32_t groups;
+		uint32_t bits[(MIROS_MAX_PRIO + 31U) / 32U];
+	} OSPrioSet;
+
+	/* Thread Control Block (TCB) */
+	typedef struct OSThread {
 		void *sp; /* stack pointer */
-		uint32_t timeout; /* timeout delay down-counter */
+#ifdef MIROS_MPU_GUARD
+		uint32_t mpuRbar; /* stack guard region base, loaded by PendSV_Handler (offset 4) */
+		uint32_t mpuRasr; /* stack guard region attributes, loaded by PendSV_Handler (offset 8) */
+#endif
+		uint32_t timeout; /* ticks after the previous thread in the timeout list */
+		struct OSThread *timeNext; /* next thread in the timeout list */
+		struct OSThread *timePrev; /* previous thread in the timeout list */
+		OSPrioSet *waitSet; /* waiting set the thread is blocked in, if any */
+		void *waitMsg; /* message handed over while blocked on an OSQueue */
+		uint32_t waitFlags; /* OSEventFlags mask waited for, then the flags that matched */
+		uint8_t waitOpts; /* OSEventFlags_wait() options */
+		OSStatus waitStatus; /* outcome of the last blocking call */
+		struct OSMutex *waitMutex; /* mutex the thread is blocked on, if any */
+		struct OSMutex *heldMutex; /* list of the mutexes owned by the thread */
+		uint16_t prio; /* current priority, raised by priority inheritance */
+		uint16_t basePrio; /* assigned priority (1 = lowest, 0 is reserved for idle) */
+		uint16_t threshold; /* preemption threshold, basePrio when the thread has none */
+		bool threshHeld; /* the threshold is in force, see OSThread_setThreshold() */
+		struct OSThread *threshPrev; /* thread whose threshold was in force before */
+#ifdef MIROS_EDF
+		uint64_t release; /* tick the current job was released */
+		uint64_t absDeadline; /* tick the current job must be done by */
+		uint32_t period; /* ticks between releases, 0 outside EDF */
+		uint32_t relDeadline; /* ticks from a release to its deadline */
+		uint16_t edfIdx; /* position in the EDF ready heap + 1, 0 when not in it */
+#endif
+		OSThreadHandler handler; /* body of a run-to-completion thread */
+		struct OSSharedStack *sharedStack; /* stack of a run-to-completion thread */
+		uint32_t *stkLimit; /* lowest usable word of the stack */
+		uint32_t *stkTop; /* top of the stack */
+#ifdef MIROS_PROFILE
+		uint64_t runCycles; /* DWT cycles spent running */
+		uint32_t switches; /* times the thread was switched in */
+		uint32_t readyStamp; /* DWT->CYCCNT when the thread was last made ready */
+		uint32_t maxResponse; /* worst cycles from being made ready to running */
+		bool responsePending; /* readyStamp waits for the thread to run */
+#endif
 		/* ... other attributes associated with a thread */
 	} OSThread;
 
 	const uint16_t TICKS_PER_SEC = 100U;
 
-	typedef void (*OSThreadHandler)();
-
 	void OS_init(void *stkSto, uint32_t stkSize);
 
 	/* callback to handle the idle condition */
 	void OS_onIdle(void);
 
-	/* this function must be called with interrupts DISABLED */
+	/* this function must be called with interrupts DISABLED, i.e. inside
+	* OS_critEnter()/OS_critExit() (miros_port.h)
+	*/
 	void OS_sched(void);
 
 	/* transfer control to the RTOS to run the threads */
@@ -34,24 +101,301 @@ namespace rtos {
 	/* blocking delay */
 	void OS_delay(uint32_t ticks);
 
-	/* process all timeouts */
+	/* ticks since OS_run(), monotonic and never wrapping */
+	uint64_t OS_getTicks(void);
+
+	/* block until *lastWake + period and advance *lastWake by one period,
+	* so a periodic thread keeps its exact rate whatever its work takes;
+	* returns false without blocking when that release time has already
+	* passed (an overrun), the caller then runs late but stays in phase
+	*/
+	bool OS_delayUntil(uint64_t *lastWake, uint32_t period);
+
+	/* process all timeouts; called from the tick interrupt, which must not
+	* be preempted by the other interrupts calling the kernel
+	*/
 	void OS_tick(void);
 
+	/* number of ticks until the nearest timeout, 0 if no thread is delayed
+	* and no timer is armed
+	* (must be called with interrupts DISABLED)
+	*/
+	uint32_t OS_idleTicks(void);
+
+	/* process several ticks at once, after a tickless idle period
+	* (must be called with interrupts DISABLED)
+	*/
+	void OS_tickAdvance(uint32_t ticks);
+
 	/* callback to configure and start interrupts */
 	void OS_onStartup(void);
 
-	void OSThread_start(OSThread *me, OSThreadHandler threadHandler, void *stkSto, uint32_t stkSize);
+	/* start a thread with a unique priority in the range 1..MIROS_MAX_PRIO */
+	void OSThread_start(OSThread *me, uint16_t prio, OSThreadHandler threadHandler, void *stkSto, uint32_t stkSize);
+
+	/* preemption threshold, as in ThreadX: once switched in, the thread is
+	* preempted only by threads above the threshold, until it blocks or
+	* delays itself; the threads in between wait as if it had their priority.
+	* threshold goes from the base priority (no threshold, the default) to
+	* MIROS_MAX_PRIO, and may change at any time, also before OS_run().
+	*/
+	void OSThread_setThreshold(OSThread *me, uint16_t threshold);
+
+#ifdef MIROS_EDF
+	/* earliest-deadline-first scheduling (-DMIROS_EDF) for the threads with
+	* priorities lo..hi: among them the ready thread with the earliest
+	* absolute deadline runs, whatever its priority, with no priorities
+	* reassigned. The band keeps its place among the fixed priorities, above
+	* lo - 1 and below hi + 1. Call once, before OS_run().
+	*/
+	void OS_edfInit(uint16_t lo, uint16_t hi);
+
+	/* make a started thread of the EDF band periodic: a job is released
+	* every period ticks, from now on, and must be done deadline ticks after
+	* its release (deadline <= period); not for run-to-completion threads
+	*/
+	void OSThread_setEdf(OSThread *me, uint32_t period, uint32_t deadline);
+
+	/* end the current job of the calling EDF thread and block until the next
+	* release; returns false when the job missed its deadline, and without
+	* blocking when the next release has already passed
+	*/
+	bool OS_edfNextPeriod(void);
+#endif
+
+	/* register threads whose TCB and stack were built at compile time, with
+	* the ready set of their priorities; see OS_startStatic() in miros_static.h
+	*/
+	void OSThread_register(OSThread * const threads[], uint16_t n, OSPrioSet const *ready);
+
+#ifdef MIROS_TIMESLICE
+	/* priorities lo..hi taken as one level of equals (-DMIROS_TIMESLICE):
+	* the thread whose turn it is keeps the CPU while it is ready, the
+	* others of the level do not preempt it, and after quantum ticks of
+	* running the turn passes to the next ready thread of the level, in
+	* descending priority order with wrap-around. A level with a single
+	* ready thread never switches. Waiting sets still release the highest
+	* priority first, so the priorities break ties on wake-up.
+	*/
+	typedef struct OSLevel {
+		uint16_t lo; /* lowest priority of the level */
+		uint16_t hi; /* highest priority of the level */
+		uint16_t turn; /* priority whose turn it is */
+		uint32_t quantum; /* ticks per turn */
+		uint32_t slice; /* ticks left in the current turn */
+	} OSLevel;
+
+	/* the priorities may be started before or after, but not be in another level */
+	void OSLevel_init(OSLevel *me, uint16_t lo, uint16_t hi, uint32_t quantum);
+#endif
 
 	typedef struct {
 		uint8_t value;
-		uint32_t waitingSet;
+		OSPrioSet waitingSet;
 	} OSSem;
 
 	void OSSem_init(OSSem *me, uint8_t initialValue);
 
-	void OSSem_pend(OSSem *me);
+	/* blocks up to timeout ticks (OS_WAIT_FOREVER for no limit) while the
+	* semaphore is zero; returns OS_OK when acquired, OS_TIMEOUT otherwise
+	*/
+	OSStatus OSSem_pend(OSSem *me, uint32_t timeout);
 
+	/* a woken higher-priority thread preempts the caller at once */
 	void OSSem_post(OSSem *me);
+
+	/* post from an interrupt; the context switch is deferred to the
+	* interrupt exit, where PendSV tail-chains. Only interrupts at or below
+	* MIROS_SYSCALL_PRIO (miros_port.h) may call the kernel.
+	*/
+	void OSSem_postFromISR(OSSem *me);
+
+	/* mutex with owner tracking, recursive locking and transitive priority inheritance */
+	typedef struct OSMutex {
+		OSThread *owner; /* thread holding the mutex, 0 when free */
+		struct OSMutex *heldNext; /* next mutex held by the same owner */
+		OSPrioSet waitingSet; /* waiting threads, by assigned priority */
+		uint8_t nest; /* recursive lock count of the owner */
+	} OSMutex;
+
+	void OSMutex_init(OSMutex *me);
+
+	/* must not be called from the idleThread */
+	void OSMutex_lock(OSMutex *me);
+
+	/* must be called by the owner, as many times as it locked the mutex */
+	void OSMutex_unlock(OSMutex *me);
+
+	/* message queue passing pointers to fixed-size blocks, so payloads are never copied */
+	typedef struct {
+		void **ring; /* storage for the queued pointers */
+		uint16_t size; /* capacity of the ring */
+		uint16_t count; /* number of queued pointers */
+		uint16_t head; /* index of the oldest pointer */
+		uint16_t tail; /* index of the next free slot */
+		OSPrioSet getWaitSet; /* threads waiting for a message */
+		OSPrioSet postWaitSet; /* threads waiting for a free slot */
+	} OSQueue;
+
+	void OSQueue_init(OSQueue *me, void *ringSto[], uint16_t size);
+
+	/* blocks up to timeout ticks while the queue is full */
+	OSStatus OSQueue_post(OSQueue *me, void *msg, uint32_t timeout);
+
+	/* never blocks; returns false when the queue is full */
+	bool OSQueue_postFromISR(OSQueue *me, void *msg);
+
+	/* blocks up to timeout ticks while the queue is empty */
+	OSStatus OSQueue_get(OSQueue *me, void **msg, uint32_t timeout);
+
+	/* group of 32 event flags; waiters are kept in a priority set, so setting
+	* flags releases every satisfied thread in a single pass
+	*/
+	typedef struct {
+		uint32_t flags; /* current flag word */
+		OSPrioSet waitingSet; /* waiting threads, by assigned priority */
+	} OSEventFlags;
+
+	/* options of OSEventFlags_wait() */
+	const uint8_t OS_FLAGS_ANY = 0x00U; /* any flag in the mask releases the thread */
+	const uint8_t OS_FLAGS_ALL = 0x01U; /* all flags in the mask are needed */
+	const uint8_t OS_FLAGS_CLEAR = 0x02U; /* consume the matching flags on exit */
+
+	void OSEventFlags_init(OSEventFlags *me, uint32_t initialFlags);
+
+	/* blocks up to timeout ticks until the mask is satisfied; the matching
+	* flags are returned in *matched (if not 0)
+	*/
+	OSStatus OSEventFlags_wait(OSEventFlags *me, uint32_t mask, uint8_t options, uint32_t timeout, uint32_t *matched);
+
+	/* set and clear never block and can be called from ISRs */
+	void OSEventFlags_set(OSEventFlags *me, uint32_t flags);
+
+	void OSEventFlags_clear(OSEventFlags *me, uint32_t flags);
+
+	typedef void (*OSTimerHandler)(void *arg);
+
+	/* software timer; the callbacks of all timers run one after another in
+	* the timer daemon thread, so they share its stack and must not block
+	* for long
+	*/
+	typedef struct OSTimer {
+		struct OSTimer *next; /* next armed timer, sorted by expiry */
+		struct OSTimer *firedNext; /* next expired timer waiting for the daemon */
+		uint32_t delta; /* ticks after the previous armed timer */
+		uint32_t period; /* reload in ticks, 0 for a one-shot timer */
+		OSTimerHandler handler;
+		void *arg; /* passed to the handler */
+		bool armed; /* in the list of armed timers */
+		bool fired; /* callback pending in the daemon */
+	} OSTimer;
+
+	void OSTimer_init(OSTimer *me, OSTimerHandler handler, void *arg);
+
+	/* (re)arm the timer to expire after ticks, then every period ticks
+	* (0 for one-shot); callable from ISRs
+	*/
+	void OSTimer_start(OSTimer *me, uint32_t ticks, uint32_t period);
+
+	/* disarm the timer and drop its pending callback, if any */
+	void OSTimer_stop(OSTimer *me);
+
+	/* start the timer daemon thread; call before OS_run() when timers are used */
+	void OS_timerInit(uint16_t prio, void *stkSto, uint32_t stkSize);
+
+	/* pool of fixed-size blocks for the messages, usable from ISRs */
+	typedef struct {
+		void *freeList; /* linked list of the free blocks */
+		uint16_t blockSize; /* bytes per block, rounded up to whole pointers */
+		uint16_t nFree; /* number of free blocks */
+	} OSPool;
+
+	void OSPool_init(OSPool *me, void *poolSto, uint32_t poolSize, uint16_t blockSize);
+
+	/* returns 0 when the pool is exhausted */
+	void *OSPool_get(OSPool *me);
+
+	void OSPool_put(OSPool *me, void *block);
+
+	/* Stack Resource Policy (immediate priority ceiling) lock
+	* NOTE: a thread must not block while it holds a resource
+	*/
+	typedef struct {
+		uint16_t ceiling; /* highest priority of the threads using the resource */
+		uint16_t prevCeiling; /* system ceiling before the resource was locked */
+		OSThread *prevHolder; /* thread holding the system ceiling before */
+	} OSResource;
+
+	/* the ceiling is computed from the (already started) threads using the resource */
+	void OSResource_init(OSResource *me, OSThread * const users[], uint16_t nUsers);
+
+	void OSResource_lock(OSResource *me);
+
+	void OSResource_unlock(OSResource *me);
+
+	/* one stack shared by run-to-completion threads; the thread running on it
+	* holds the stack like an SRP resource, so the other users cannot start
+	* until it returns
+	*/
+	typedef struct OSSharedStack {
+		OSResource res; /* ceiling = highest priority of the threads sharing the stack */
+		uint32_t *top; /* 8-byte aligned top of the stack */
+		uint32_t *bottom; /* 8-byte aligned bottom of the stack */
+	} OSSharedStack;
+
+	void OSSharedStack_init(OSSharedStack *me, void *stkSto, uint32_t stkSize);
+
+	/* start a run-to-completion thread: threadHandler runs once per
+	* OSThread_activate() and returns; it must not block
+	*/
+	void OSThread_startRtc(OSThread *me, uint16_t prio, OSThreadHandler threadHandler, OSSharedStack *stk);
+
+	/* make a run-to-completion thread ready (callable from ISRs);
+	* activations while the thread is already ready are not counted
+	*/
+	void OSThread_activate(OSThread *me);
+
+	/* maximum number of stack words the thread ever used, found by
+	* scanning the 0xDEADBEEF painting from the bottom of its stack
+	*/
+	uint32_t OSThread_stackHighWater(OSThread const *me);
+
+	typedef struct {
+		OSThread *thread;
+		uint32_t size; /* usable stack words */
+		uint32_t used; /* high-water mark in words */
+	} OSStackStats;
+
+	/* fill in the stack usage of up to maxCount started threads,
+	* in priority order, and return how many were filled
+	*/
+	uint16_t OS_stackStats(OSStackStats stats[], uint16_t maxCount);
+
+#ifdef MIROS_PROFILE
+	typedef struct {
+		OSThread *thread;
+		uint64_t runCycles; /* DWT cycles spent running */
+		uint32_t switches; /* times the thread was switched in */
+		uint32_t maxResponse; /* worst cycles from being made ready to running */
+		uint16_t cpu; /* share of the CPU since OS_run(), in 0.01 % */
+	} OSThreadStats;
+
+	/* fill in the runtime statistics of up to maxCount started threads,
+	* idleThread included, in priority order, and return how many were filled
+	*/
+	uint16_t OS_getStats(OSThreadStats stats[], uint16_t maxCount);
+
+	/* worst-case cycles (DWT->CYCCNT) spent in OS_sched() with interrupts disabled */
+	extern uint32_t OS_schedMaxCycles;
+
+	/* worst-case cycles (DWT->CYCCNT) spent in OS_tick() */
+	extern uint32_t OS_tickMaxCycles;
+
+	/* DWT->CYCCNT when the first thread was switched in; the counter starts
+	* in SystemInit(), so this is the boot time from reset
+	*/
+	extern uint32_t OS_bootCycles;
+#endif
 }
 
 #endif /* INC_MIROS_H_ */
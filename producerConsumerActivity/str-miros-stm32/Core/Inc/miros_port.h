@@ -0,0 +1,168 @@
+/*
+ * miros_port.h
+ *
+ * What the kernel (miros.cpp) needs from the CPU it runs on. The Cortex-M4
+ * port (miros_port_cm4.cpp) is the default; host/ builds the same kernel
+ * with -DMIROS_PORT_POSIX and a POSIX port, to run MiROS applications as a
+ * Linux process. Each port provides the nestable kernel critical section
+ * OS_critEnter()/OS_critExit(), the CMSIS intrinsics the kernel uses
+ * (__CLZ(), __COMPILER_BARRIER(), __get_IPSR()), a free-running cycle
+ * counter for the kernel measurements, and the functions below.
+ */
+
+#ifndef INC_MIROS_PORT_H_
+#define INC_MIROS_PORT_H_
+
+#include <cstdint>
+#include "miros.h"
+
+#ifdef MIROS_PORT_POSIX
+#include "miros_posix.h"
+#else
+#include "stm32g4xx.h"
+
+/* NVIC priority (0 most urgent) of the most urgent interrupt allowed to
+* call the kernel. The kernel critical sections raise BASEPRI to it, so the
+* interrupts above (numerically below) it are never delayed by the kernel,
+* but must not call it. SysTick runs at this priority. 0 masks every
+* interrupt with PRIMASK instead.
+*/
+#ifndef MIROS_SYSCALL_PRIO
+#define MIROS_SYSCALL_PRIO 1U
+#endif
+
+static_assert(MIROS_SYSCALL_PRIO < (1U << __NVIC_PRIO_BITS), "MIROS_SYSCALL_PRIO is not an NVIC priority");
+
+/* MIROS_SYSCALL_PRIO in the implemented upper bits of BASEPRI */
+#define OS_CRIT_BASEPRI (MIROS_SYSCALL_PRIO << (8U - __NVIC_PRIO_BITS))
+
+/* with -DMIROS_CCM the kernel hot path (OS_CCM_CODE), the vector table
+* and the objects marked OS_CCM_DATA (zeroed, e.g. thread stacks) or
+* OS_CCM_INIT (initialized, e.g. Thread<> objects) go to the 32 KB CCM
+* SRAM: no flash wait states at 170 MHz and a bus of its own. The startup
+* code copies .ccmram from flash and zeroes .ccmbss.
+*/
+#ifdef MIROS_CCM
+#define OS_CCM_CODE __attribute__((section(".ccmram")))
+#define OS_CCM_DATA __attribute__((section(".ccmbss")))
+#define OS_CCM_INIT __attribute__((section(".ccmdata")))
+#else
+#define OS_CCM_CODE
+#define OS_CCM_DATA
+#define OS_CCM_INIT
+#endif
+
+/* cycle counter of the kernel measurements (MIROS_PROFILE, MIROS_TRACE) */
+#define OS_PORT_CYCLES() (DWT->CYCCNT)
+#define OS_PORT_CYCLES_HZ() (SystemCoreClock)
+
+namespace rtos {
+	/* initial context of a thread, from the lowest address: what
+	* PendSV_Handler pops, then the exception frame of the return
+	*/
+	typedef struct {
+		uint32_t r4_r11[8];
+		uint32_t excReturn;
+		uint32_t r0_r3[4];
+		uint32_t r12;
+		uint32_t lr;
+		OSThreadHandler pc;
+		uint32_t xpsr;
+	} OSPortFrame;
+
+	/* the frame has no addresses to compute, so Thread<> (miros_static.h)
+	* builds it at compile time
+	*/
+#define OS_PORT_STATIC_FRAME
+
+	static constexpr OSPortFrame OS_portInitFrame(OSThreadHandler threadHandler, uint32_t lr) {
+		return OSPortFrame{
+			{ 4U, 5U, 6U, 7U, 8U, 9U, 10U, 11U }, /* fake R4-R11 */
+			0xFFFFFFF9U, /* EXC_RETURN: thread mode, main stack, no FPU context yet */
+			{ 0U, 1U, 2U, 3U }, /* fake R0-R3 */
+			0x0000000CU, /* R12 */
+			lr,
+			threadHandler,
+			(1U << 24) /* xPSR: Thumb state */
+		};
+	}
+
+#if defined(MIROS_PROFILE) || defined(MIROS_TRACE)
+	/* stack PendSV_Handler lends OS_switchHook() below the saved context
+	* of the thread switched out, with the 8-byte alignment of the call
+	*/
+	const uint32_t OS_PORT_HOOK_STACK = 64U;
+#else
+	const uint32_t OS_PORT_HOOK_STACK = 0U;
+#endif
+
+	/* smallest thread stack in bytes: one saved context */
+	const uint32_t OS_PORT_STACK_MIN = sizeof(OSPortFrame) + OS_PORT_HOOK_STACK;
+
+	/* enter a kernel critical section, from a thread or an interrupt, and
+	* return the mask to hand back to OS_critExit(); sections nest
+	*/
+	static inline uint32_t OS_critEnter(void) {
+#if (MIROS_SYSCALL_PRIO == 0U)
+		uint32_t primask = __get_PRIMASK();
+		__disable_irq();
+		return primask;
+#else
+		uint32_t basepri = __get_BASEPRI();
+		__set_BASEPRI_MAX(OS_CRIT_BASEPRI); /* never lowers an enclosing mask */
+		__ISB();
+		return basepri;
+#endif
+	}
+
+	/* leave the critical section, pending switches run at the outermost one */
+	static inline void OS_critExit(uint32_t mask) {
+#if (MIROS_SYSCALL_PRIO == 0U)
+		__set_PRIMASK(mask);
+#else
+		__set_BASEPRI(mask);
+#endif
+	}
+
+	/* request the switch to OS_next, which happens once interrupts are
+	* enabled: PendSV runs at the lowest priority
+	* (must be called with interrupts DISABLED)
+	*/
+	static inline void OS_portPend(void) {
+		*(uint32_t volatile *)0xE000ED04 = (1U << 28);
+	}
+}
+#endif
+
+namespace rtos {
+	/* called by OS_init() before any thread is started */
+	void OS_portInit(void);
+
+	/* build the initial context of a thread in its stack [bottom, top), so
+	* that it starts in threadHandler when switched in; returns its sp.
+	* When rtc is set the handler returns into OS_rtcPark(), off the stack.
+	*/
+	void *OS_portFrame(uint32_t *bottom, uint32_t *top, OSThreadHandler threadHandler, bool rtc);
+
+	/* reserve the stack overflow guard of a thread, if the port has one;
+	* returns the lowest word left usable above bottom
+	*/
+	uint32_t *OS_portGuard(OSThread *me, uint32_t *bottom, uint32_t *top);
+
+	/* called by OS_run() right before the first switch */
+	void OS_portRun(void);
+
+	/* end of a run-to-completion activation, entered by the port with
+	* interrupts DISABLED once the thread left its shared stack
+	*/
+	void OS_rtcPark(void);
+
+#if defined(MIROS_PROFILE) || defined(MIROS_TRACE)
+	/* called by the port on every switch with interrupts DISABLED, once
+	* OS_curr is the thread being switched in
+	*/
+	void OS_switchHook(void);
+#endif
+}
+
+#endif /* INC_MIROS_PORT_H_ */
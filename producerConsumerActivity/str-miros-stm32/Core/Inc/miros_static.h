@@ -0,0 +1,124 @@
+/*
+ * miros_static.h
+ *
+ * Threads defined at compile time, as an alternative to OSThread_start():
+ *
+ *   void producer();
+ *   rtos::Thread<40U, 2U, &producer> prod;
+ *   ...
+ *   rtos::OS_init(stack_idleThread, sizeof(stack_idleThread));
+ *   rtos::OS_startStatic(prod, cons);
+ *   rtos::OS_run();
+ *
+ * The compiler checks the priority range, the stack size and that the
+ * threads given to OS_startStatic() have unique priorities. The painted
+ * stack, the TCB and, on ports with OS_PORT_STATIC_FRAME, the initial
+ * context are constant data, and the ready set of the threads is computed
+ * at compile time; OS_startStatic() only links them into the kernel tables.
+ */
+
+#ifndef INC_MIROS_STATIC_H_
+#define INC_MIROS_STATIC_H_
+
+#include <cstddef>
+#include <cstdint>
+#include "miros.h"
+#include "miros_port.h"
+
+namespace rtos {
+	/* a thread with a stack of StackWords words and an optional preemption
+	* threshold (OSThread_setThreshold()); ports that build the initial
+	* context at compile time keep it right above the stack
+	*/
+	template <uint32_t StackWords, uint16_t Prio, OSThreadHandler Entry, uint16_t Threshold = Prio>
+	struct alignas(8) Thread {
+		static_assert((Prio >= 1U) && (Prio <= MIROS_MAX_PRIO), "thread priority out of 1..MIROS_MAX_PRIO");
+		static_assert((Threshold >= Prio) && (Threshold <= MIROS_MAX_PRIO), "preemption threshold out of Prio..MIROS_MAX_PRIO");
+		static_assert((StackWords * 4U) >= OS_PORT_STACK_MIN, "thread stack below OS_PORT_STACK_MIN");
+		static_assert(Entry != nullptr, "thread without a body");
+
+		static constexpr uint16_t prio = Prio;
+
+#ifdef OS_PORT_STATIC_FRAME
+		static constexpr uint32_t frameWords = sizeof(OSPortFrame) / 4U;
+#else
+		static constexpr uint32_t frameWords = 0U;
+#endif
+
+		/* one word longer when needed to keep the stack top 8-byte aligned */
+		static constexpr uint32_t stackWords = StackWords + ((StackWords + frameWords) % 2U);
+
+		uint32_t stack[stackWords];
+#ifdef OS_PORT_STATIC_FRAME
+		OSPortFrame frame;
+#endif
+		OSThread tcb;
+
+		constexpr Thread() : stack(),
+#ifdef OS_PORT_STATIC_FRAME
+			frame(OS_portInitFrame(Entry, 0x0000000EU)),
+#endif
+			tcb() {
+			for(uint32_t &word : stack){
+				word = 0xDEADBEEFU;
+			}
+#ifdef OS_PORT_STATIC_FRAME
+			tcb.sp = &frame;
+#endif
+			tcb.prio = Prio;
+			tcb.basePrio = Prio;
+			tcb.threshold = Threshold;
+			tcb.handler = Entry;
+			tcb.stkLimit = &stack[0];
+		}
+
+		/* what needs addresses as numbers, done by OS_startStatic() */
+		void bind(void) {
+#ifdef OS_PORT_STATIC_FRAME
+			tcb.stkTop = reinterpret_cast<uint32_t *>(&frame + 1);
+#else
+			tcb.stkTop = &stack[stackWords];
+			tcb.sp = OS_portFrame(&stack[0], tcb.stkTop, Entry, false);
+#endif
+		}
+	};
+
+	template <std::size_t N>
+	constexpr bool OS_prioUnique(uint16_t const (&prios)[N]) {
+		for(std::size_t i = 0U; i < N; i++){
+			for(std::size_t j = i + 1U; j < N; j++){
+				if(prios[i] == prios[j]){
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	template <std::size_t N>
+	constexpr OSPrioSet OS_prioSetOf(uint16_t const (&prios)[N]) {
+		OSPrioSet set{};
+		for(uint16_t prio : prios){
+			uint32_t const n = (uint32_t)prio - 1U;
+			set.bits[n >> 5] |= (1U << (n & 31U));
+			set.groups |= (1U << (n >> 5));
+		}
+		return set;
+	}
+
+	/* make the Thread<> objects ready to run, after OS_init() */
+	template <typename... Threads>
+	void OS_startStatic(Threads &... threads) {
+		static_assert(sizeof...(Threads) != 0U, "no threads to start");
+
+		static constexpr uint16_t prios[] = { Threads::prio... };
+		static_assert(OS_prioUnique(prios), "two threads share a priority");
+		static constexpr OSPrioSet ready = OS_prioSetOf(prios);
+
+		(threads.bind(), ...);
+		OSThread * const tcbs[] = { &threads.tcb... };
+		OSThread_register(tcbs, (uint16_t)sizeof...(Threads), &ready);
+	}
+}
+
+#endif /* INC_MIROS_STATIC_H_ */
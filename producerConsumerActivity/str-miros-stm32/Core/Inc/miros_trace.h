@@ -0,0 +1,89 @@
+/*
+ * miros_trace.h
+ *
+ * Kernel event trace recorder, built in with -DMIROS_TRACE. The events go
+ * into a RAM ring (a flight recorder, the oldest records are overwritten)
+ * timestamped with DWT->CYCCNT (OS_PORT_CYCLES() of the port).
+ * tools/traceDecoder turns a dump of OS_trace into a timeline and
+ * Chrome/Perfetto JSON.
+ *
+ * Overhead: OS_traceRecord() is about 15 instructions with interrupts
+ * masked. The cycles it costs on the target are measured, not assumed:
+ * the two OS_EVT_CALIB records written back to back by OS_traceInit()
+ * give the figure the decoder prints, and the "trace" benchmark of the
+ * Renode suite times it with DWT->CYCCNT over many records.
+ */
+
+#ifndef INC_MIROS_TRACE_H_
+#define INC_MIROS_TRACE_H_
+
+#include <cstdint>
+
+namespace rtos {
+	/* event codes, with the meaning of the param and id fields */
+	const uint8_t OS_EVT_CALIB = 0U; /* recorder self-measurement */
+	const uint8_t OS_EVT_SWITCH = 1U; /* context switch, id = priority of the thread switched in */
+	const uint8_t OS_EVT_TICK = 2U; /* system tick, id = low 16 bits of the tick count */
+	const uint8_t OS_EVT_SEM_PEND = 3U; /* id = semaphore, param = OS_PEND_... */
+	const uint8_t OS_EVT_SEM_POST = 4U; /* id = semaphore, param = 1 when a thread was woken */
+	const uint8_t OS_EVT_ISR_ENTER = 5U; /* param = exception number (IPSR) */
+	const uint8_t OS_EVT_ISR_EXIT = 6U; /* param = exception number (IPSR) */
+
+	/* param of OS_EVT_SEM_PEND */
+	const uint8_t OS_PEND_TAKEN = 0U; /* acquired without blocking */
+	const uint8_t OS_PEND_BLOCKED = 1U; /* the caller blocks */
+	const uint8_t OS_PEND_WOKEN = 2U; /* acquired after blocking */
+	const uint8_t OS_PEND_TIMEOUT = 3U; /* gave up after blocking */
+
+	typedef struct {
+		uint32_t timestamp; /* DWT->CYCCNT */
+		uint8_t event;
+		uint8_t param;
+		uint16_t id; /* thread priority, or object address / 4 */
+	} OSTraceRecord;
+
+	const uint32_t OS_TRACE_MAGIC = 0x4352544DU; /* "MTRC" in a little-endian dump */
+
+	/* number of records, a power of two */
+#ifndef MIROS_TRACE_SIZE
+#define MIROS_TRACE_SIZE 256U
+#endif
+	static_assert((MIROS_TRACE_SIZE & (MIROS_TRACE_SIZE - 1U)) == 0U, "MIROS_TRACE_SIZE must be a power of two");
+
+	/* the layout read by the decoder from a memory dump */
+	typedef struct {
+		uint32_t magic; /* OS_TRACE_MAGIC once the recorder runs */
+		uint32_t cpuHz; /* DWT->CYCCNT frequency */
+		uint32_t head; /* free-running index of the next record */
+		uint32_t size; /* number of records */
+		OSTraceRecord rec[MIROS_TRACE_SIZE];
+	} OSTraceBuffer;
+
+#ifdef MIROS_TRACE
+	extern OSTraceBuffer OS_trace;
+
+	/* start the recorder; called from OS_onStartup() once DWT runs */
+	void OS_traceInit(void);
+
+	/* append one record, callable from any context */
+	void OS_traceRecord(uint8_t event, uint8_t param, uint16_t id);
+
+	/* records the switch to OS_curr, called by the kernel's switch hook */
+	void OS_traceSwitch(void);
+#endif
+}
+
+#ifdef MIROS_TRACE
+#define OS_TRACE(event_, param_, id_) (rtos::OS_traceRecord((event_), (param_), (uint16_t)(id_)))
+#define OS_TRACE_OBJ(obj_) ((uint16_t)((uintptr_t)(obj_) >> 2))
+/* place at the start and at the end of the ISRs to be traced */
+#define OS_TRACE_ISR_ENTER() OS_TRACE(rtos::OS_EVT_ISR_ENTER, (uint8_t)__get_IPSR(), 0U)
+#define OS_TRACE_ISR_EXIT() OS_TRACE(rtos::OS_EVT_ISR_EXIT, (uint8_t)__get_IPSR(), 0U)
+#else
+#define OS_TRACE(event_, param_, id_) ((void)0)
+#define OS_TRACE_OBJ(obj_) 0U
+#define OS_TRACE_ISR_ENTER() ((void)0)
+#define OS_TRACE_ISR_EXIT() ((void)0)
+#endif
+
+#endif /* INC_MIROS_TRACE_H_ */
@@ -0,0 +1,101 @@
+/*
+ * spsc_ring.h
+ *
+ *  Lock-free single-producer/single-consumer ring buffer for MiROS
+ */
+
+#ifndef INC_SPSC_RING_H_
+#define INC_SPSC_RING_H_
+
+#include <cstdint>
+#include "miros.h"
+#include "miros_port.h"
+
+namespace rtos {
+	/* ring buffer between exactly one producer and one consumer thread
+	* tail is written only by the producer and head only by the consumer,
+	* so passing an item takes no critical section; a thread blocks on a
+	* semaphore only when it finds the ring full (producer) or empty (consumer)
+	*/
+	template <typename T, uint32_t N>
+	class SpscRing {
+		static_assert((N != 0U) && ((N & (N - 1U)) == 0U), "SpscRing capacity must be a power of two");
+
+	public:
+		SpscRing() : head(0U), tail(0U), prodWaiting(false), consWaiting(false) {
+			OSSem_init(&notFull, 0U);
+			OSSem_init(&notEmpty, 0U);
+		}
+
+		/* producer side, returns false when the ring is full */
+		bool tryPush(T const &item) {
+			uint32_t t = tail;
+			if((t - head) == N){
+				return false;
+			}
+			buf[t & (N - 1U)] = item;
+			__COMPILER_BARRIER();		/* the item is stored before it is published */
+			tail = t + 1U;
+
+			if(consWaiting){			/* the ring was empty and the consumer went to sleep */
+				consWaiting = false;
+				OSSem_post(&notEmpty);
+			}
+			return true;
+		}
+
+		/* consumer side, returns false when the ring is empty */
+		bool tryPop(T &item) {
+			uint32_t h = head;
+			if(tail == h){
+				return false;
+			}
+			item = buf[h & (N - 1U)];
+			__COMPILER_BARRIER();		/* the item is read before its slot is released */
+			head = h + 1U;
+
+			if(prodWaiting){			/* the ring was full and the producer went to sleep */
+				prodWaiting = false;
+				OSSem_post(&notFull);
+			}
+			return true;
+		}
+
+		/* producer side, blocks while the ring is full */
+		void push(T const &item) {
+			while(!tryPush(item)){
+				prodWaiting = true;
+				if(tryPush(item)){		/* the consumer may have made room meanwhile */
+					prodWaiting = false;
+					break;
+				}
+				(void)OSSem_pend(&notFull, OS_WAIT_FOREVER);
+			}
+		}
+
+		/* consumer side, blocks while the ring is empty */
+		T pop() {
+			T item;
+			while(!tryPop(item)){
+				consWaiting = true;
+				if(tryPop(item)){		/* the producer may have pushed meanwhile */
+					consWaiting = false;
+					break;
+				}
+				(void)OSSem_pend(&notEmpty, OS_WAIT_FOREVER);
+			}
+			return item;
+		}
+
+	private:
+		T buf[N];
+		uint32_t volatile head; /* free-running read index */
+		uint32_t volatile tail; /* free-running write index */
+		bool volatile prodWaiting; /* producer is (about to be) blocked on notFull */
+		bool volatile consWaiting; /* consumer is (about to be) blocked on notEmpty */
+		OSSem notFull;
+		OSSem notEmpty;
+	};
+}
+
+#endif /* INC_SPSC_RING_H_ */
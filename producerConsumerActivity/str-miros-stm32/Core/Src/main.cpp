@@ -18,84 +18,134 @@
 
 #include "main.h"
 #include <cstdint>
+#include <cstdio>
 #include "miros.h"
+#include "miros_port.h"
+#include "miros_static.h"
+#include "spsc_ring.h"
 
-uint32_t bufferSize = 10, occupiedPositions  = 0, head = 0, tail = 0;
-uint32_t buffer[bufferSize];
-rtos::OSSem mtx;
-rtos::OSSem noEmptySpaces;
-rtos::OSSem noItemsAvailable;
-
-bool insert(uint32_t code){
-	if(occupiedPositions < bufferSize){
-		buffer[tail] = code;
-		tail = (tail + 1) % bufferSize;
-		occupiedPositions++;
-		return true;
-	} else{
-		return false;
-	}
-}
+rtos::SpscRing<uint32_t, 16U> buffer;
 
-uint32_t remove(){
-	if(occupiedPositions > 0){
-		uint32_t code = buffer[head];
-		head = (head + 1) % bufferSize;
-		occupiedPositions--;
-		return code;
-	}
-	return 0;
-}
+/* periods that started late, because the previous one overran */
+uint32_t volatile prodOverruns;
+uint32_t volatile consOverruns;
 
-uint32_t stackProd[40];
-rtos::OSThread prod;
+/* the threads and their stacks are built at compile time (miros_static.h)
+* and go to the CCM SRAM with -DMIROS_CCM
+*/
 void producer(){
 	uint32_t code = 1;
+	uint64_t lastWake = rtos::OS_getTicks();
 
 	while(1){
-		rtos::OSSem_pend(&noEmptySpaces);
-
-		rtos::OSSem_pend(&mtx);
-		insert(code);
-		rtos::OSSem_post(&mtx);
-
-		rtos::OSSem_post(&noItemsAvailable);
+		buffer.push(code);
 
 		code++;
-		rtos::OS_delay(rtos::TICKS_PER_SEC);
+		if(!rtos::OS_delayUntil(&lastWake, rtos::TICKS_PER_SEC)){
+			prodOverruns++;
+		}
 	}
 }
+constinit rtos::Thread<40U, 2U, &producer> prod OS_CCM_INIT;
 
-uint32_t stackCons[40];
-rtos::OSThread cons;
 void consumer(){
+	uint64_t lastWake = rtos::OS_getTicks();
+
 	while(1){
-		rtos::OSSem_pend(&noItemsAvailable);
+		buffer.pop();
 
-		rtos::OSSem_pend(&mtx);
-		remove();
-		rtos::OSSem_post(&mtx);
+		if(!rtos::OS_delayUntil(&lastWake, rtos::TICKS_PER_SEC)){
+			consOverruns++;
+		}
+	}
+}
+constinit rtos::Thread<40U, 1U, &consumer> cons OS_CCM_INIT;
+
+#ifdef MIROS_PROFILE
+/* USART2 TX on PA2 (ST-LINK virtual COM port), 115200 8N1, polled;
+* printf() reaches it through _write() in syscalls.c
+*/
+static void console_init(void){
+	RCC->AHB2ENR |= RCC_AHB2ENR_GPIOAEN;
+	RCC->APB1ENR1 |= RCC_APB1ENR1_USART2EN;
+	GPIOA->AFR[0] = (GPIOA->AFR[0] & ~GPIO_AFRL_AFSEL2) | (7U << GPIO_AFRL_AFSEL2_Pos);
+	GPIOA->MODER = (GPIOA->MODER & ~GPIO_MODER_MODE2) | GPIO_MODER_MODE2_1;
+	USART2->BRR = HAL_RCC_GetPCLK1Freq() / 115200U;
+	USART2->CR1 = USART_CR1_TE | USART_CR1_UE;
+}
 
-		rtos::OSSem_post(&noEmptySpaces);
+extern "C" int __io_putchar(int ch){
+	while((USART2->ISR & USART_ISR_TXE_TXFNF) == 0U){
+	}
+	USART2->TDR = (uint8_t)ch;
+	return ch;
+}
 
-		rtos::OS_delay(rtos::TICKS_PER_SEC);
+/* RAM of the thread stacks, from their high-water marks: a stack shared
+* by run-to-completion threads counts once, and is set against the RAM
+* a stack per thread would take
+*/
+static void ramReport(void){
+	rtos::OSStackStats stk[8];
+	uint16_t n = rtos::OS_stackStats(stk, 8U);
+	uint32_t total = 0U;
+	uint32_t separate = 0U;
+
+	printf("\r\nprio  stack [B]  used [B]  shared\r\n");
+	for(uint16_t i = 0U; i < n; i++){
+		rtos::OSSharedStack const *shared = stk[i].thread->sharedStack;
+		printf("%4u  %9lu  %8lu  %s\r\n", stk[i].thread->basePrio, (unsigned long)(stk[i].size * 4U),
+			(unsigned long)(stk[i].used * 4U), (shared != (rtos::OSSharedStack *)0) ? "yes" : "no");
+
+		separate += stk[i].size * 4U;
+		bool counted = false;
+		for(uint16_t j = 0U; (shared != (rtos::OSSharedStack *)0) && (j < i); j++){
+			counted = counted || (stk[j].thread->sharedStack == shared);
+		}
+		if(!counted){
+			total += stk[i].size * 4U;
+		}
 	}
+	printf("stacks: %lu B (%lu B with a stack per thread), TCB: %u B per thread\r\n",
+		(unsigned long)total, (unsigned long)separate, (unsigned)sizeof(rtos::OSThread));
 }
 
-uint32_t stack_idleThread[40];
+/* prints the boot time, then the runtime statistics and the RAM report
+* of all threads every 5 s
+*/
+void monitorThread(){
+	rtos::OSThreadStats stats[4];
+	uint64_t lastWake = rtos::OS_getTicks();
 
-int main(void){
-	rtos::OS_init(stack_idleThread, sizeof(stack_idleThread));
+	console_init();
+	printf("\r\nboot to first thread: %lu cycles\r\n", (unsigned long)rtos::OS_bootCycles);
+	while(1){
+		rtos::OS_delayUntil(&lastWake, 5U * rtos::TICKS_PER_SEC);
+
+		uint16_t n = rtos::OS_getStats(stats, 4U);
+		printf("\r\nprio  switches  max resp [cyc]  runtime [ms]     CPU\r\n");
+		for(uint16_t i = 0U; i < n; i++){
+			printf("%4u  %8lu  %14lu  %12lu  %3u.%02u%%\r\n", stats[i].thread->basePrio,
+				(unsigned long)stats[i].switches, (unsigned long)stats[i].maxResponse,
+				(unsigned long)(stats[i].runCycles / (SystemCoreClock / 1000U)), stats[i].cpu / 100U, stats[i].cpu % 100U);
+		}
+		ramReport();
+	}
+}
+constinit rtos::Thread<256U, 3U, &monitorThread> monitor OS_CCM_INIT;
+#endif
 
-	rtos::OSSem_init(&mtx, 1);
-	rtos::OSSem_init(&noEmptySpaces, bufferSize);
-	rtos::OSSem_init(&noItemsAvailable, 0);
+uint32_t stack_idleThread[40] OS_CCM_DATA;
 
-	/* start blinky1 thread */
-	rtos::OSThread_start(&prod, &producer, stackProd, sizeof(stackProd));
+int main(void){
+	rtos::OS_init(stack_idleThread, sizeof(stack_idleThread));
 
-	/* start blinky2 thread */
-	rtos::OSThread_start(&cons, &consumer, stackCons, sizeof(stackCons));
+	/* start the producer, the consumer and the statistics monitor */
+#ifdef MIROS_PROFILE
+	rtos::OS_startStatic(prod, cons, monitor);
+#else
+	rtos::OS_startStatic(prod, cons);
+#endif
 
 	/* transfer control to the RTOS to run the threads */
 	rtos::OS_run();
@@ -1,5 +1,5 @@
 /****************************************************************************
-* MInimal Real-time Operating System (MiROS), GNU-ARM port.
+* MInimal Real-time Operating System (MiROS), portable kernel.
 *
 * This software is a teaching aid to illustrate the concepts underlying
 * a Real-Time Operating System (RTOS). The main goal of the software is
@@ -29,22 +29,467 @@
 * https://github.com/QuantumLeaps/MiROS
 ****************************************************************************/
 #include <cstdint>
+#include <cstddef>
 #include "miros.h"
+#include "miros_port.h"
+#include "miros_trace.h"
 #include "qassert.h"
-#include "stm32g4xx.h"
 
 Q_DEFINE_THIS_FILE
 
+/* index of the most significant 1-bit (1..32), a single CLZ instruction */
+#define LOG2(x_) (32U - __CLZ(x_))
+
 namespace rtos{
 	OSThread * volatile OS_curr; /* pointer to the current thread */
 	OSThread * volatile OS_next; /* pointer to the next thread to run */
 
-	OSThread *OS_thread[32 + 1]; /* array of threads started so far */
-	uint32_t OS_readySet; /* bitmask of threads that are ready to run */
+	OSThread *OS_thread[MIROS_MAX_PRIO + 1U]; /* array of threads started so far, indexed by assigned priority */
+	OSThread *OS_prioTbl[MIROS_MAX_PRIO + 1U]; /* ready thread holding each priority, incl. inherited ones */
+	OSPrioSet OS_readySet; /* priorities that have a thread ready to run */
+
+#ifdef MIROS_TIMESLICE
+	static OSLevel *OS_level[MIROS_MAX_PRIO + 1U]; /* level of each priority, 0 for a level of its own */
+#endif
+
+	/* threads whose preemption threshold is in force, the one switched in last
+	* on top; preemptions nest, so only the top can ever stop being ready
+	*/
+	static OSThread *OS_threshTop;
+
+#ifdef MIROS_EDF
+	static uint16_t OS_edfLo; /* priorities of the EDF band, none while OS_edfHi is 0 */
+	static uint16_t OS_edfHi;
+
+	/* ready EDF threads as a binary min-heap on the absolute deadline,
+	* so the earliest one is always OS_edfHeap[0]
+	*/
+	static OSThread *OS_edfHeap[MIROS_MAX_PRIO];
+	static uint16_t OS_edfCount;
+#endif
+
+	uint16_t OS_ceiling; /* SRP system ceiling, 0 when no resource is held */
+	OSThread *OS_ceilingHolder; /* thread holding the system ceiling */
+
+	/* delayed threads sorted by expiry; each timeout is relative to the
+	* previous entry, so a tick only ever touches the head of the list
+	*/
+	OSThread *OS_timeHead;
+
+	static uint64_t OS_tickCtr; /* ticks since OS_run() */
+
+	/* armed software timers, kept as a delta list like the thread timeouts;
+	* expired timers are queued in firing order for the timer daemon
+	*/
+	OSTimer *OS_timerHead;
+	static OSTimer *OS_firedHead;
+	static OSTimer *OS_firedTail;
+	static OSSem OS_timerSem; /* binary: the daemon has expired timers to run */
+	static OSThread OS_timerThread;
+
+#ifdef MIROS_PROFILE
+	uint32_t OS_schedMaxCycles;
+	uint32_t OS_tickMaxCycles;
+	uint32_t OS_bootCycles;
+
+	static OSThread *OS_running; /* thread the CPU time is charged to */
+	static uint32_t OS_runStamp; /* OS_PORT_CYCLES() when OS_running was last charged */
+
+	/* charge the cycles since the last call to the running thread; called
+	* at least once per tick, so CYCCNT never wraps in between
+	*/
+	static OS_CCM_CODE void OS_runAccount(uint32_t now) {
+		if(OS_running != (OSThread *)0){
+			OS_running->runCycles += (uint32_t)(now - OS_runStamp);
+		}
+		OS_runStamp = now;
+	}
+#endif
+
+	static void OS_setClear(OSPrioSet *s) {
+		s->groups = 0U;
+		for(uint32_t n = 0U; n < Q_DIM(s->bits); n++){
+			s->bits[n] = 0U;
+		}
+	}
+
+	static inline void OS_setInsert(OSPrioSet *s, uint16_t prio) {
+		uint32_t const n = (uint32_t)prio - 1U;
+		s->bits[n >> 5] |= (1U << (n & 31U));
+		s->groups |= (1U << (n >> 5));
+	}
+
+	static inline void OS_setRemove(OSPrioSet *s, uint16_t prio) {
+		uint32_t const n = (uint32_t)prio - 1U;
+		s->bits[n >> 5] &= ~(1U << (n & 31U));
+		if(s->bits[n >> 5] == 0U){
+			s->groups &= ~(1U << (n >> 5));
+		}
+	}
+
+	static inline bool OS_setHas(OSPrioSet const *s, uint16_t prio) {
+		uint32_t const n = (uint32_t)prio - 1U;
+		return (s->bits[n >> 5] & (1U << (n & 31U))) != 0U;
+	}
+
+	/* highest priority in the set, 0 when the set is empty */
+	static inline uint16_t OS_setFindMax(OSPrioSet const *s) {
+		if(s->groups == 0U){
+			return 0U;
+		}
+		uint32_t const g = LOG2(s->groups) - 1U;
+		return (uint16_t)((g << 5) + LOG2(s->bits[g]));
+	}
+
+	/* highest priority in the set below the given one, 0 if none */
+	static inline uint16_t OS_setFindBelow(OSPrioSet const *s, uint16_t prio) {
+		if(prio <= 1U){
+			return 0U;
+		}
+		uint32_t const n = (uint32_t)prio - 2U; /* bit of prio - 1 */
+		uint32_t g = n >> 5;
+		uint32_t bits = s->bits[g] & (0xFFFFFFFFU >> (31U - (n & 31U)));
+		if(bits == 0U){
+			uint32_t const groups = s->groups & ((1U << g) - 1U);
+			if(groups == 0U){
+				return 0U;
+			}
+			g = LOG2(groups) - 1U;
+			bits = s->bits[g];
+		}
+		return (uint16_t)((g << 5) + LOG2(bits));
+	}
+
+#ifdef MIROS_EDF
+	static inline void OS_edfPlace(uint16_t i, OSThread *t) {
+		OS_edfHeap[i] = t;
+		t->edfIdx = (uint16_t)(i + 1U);
+	}
+
+	/* move the entry at i up to its place, O(log n) */
+	static OS_CCM_CODE void OS_edfUp(uint16_t i) {
+		OSThread *t = OS_edfHeap[i];
+		while(i > 0U){
+			uint16_t const parent = (uint16_t)((i - 1U) / 2U);
+			if(OS_edfHeap[parent]->absDeadline <= t->absDeadline){
+				break;
+			}
+			OS_edfPlace(i, OS_edfHeap[parent]);
+			i = parent;
+		}
+		OS_edfPlace(i, t);
+	}
+
+	/* move the entry at i down to its place, O(log n) */
+	static OS_CCM_CODE void OS_edfDown(uint16_t i) {
+		OSThread *t = OS_edfHeap[i];
+		while(1){
+			uint16_t child = (uint16_t)((2U * i) + 1U);
+			if(child >= OS_edfCount){
+				break;
+			}
+			if(((child + 1U) < OS_edfCount) && (OS_edfHeap[child + 1U]->absDeadline < OS_edfHeap[child]->absDeadline)){
+				child++;
+			}
+			if(t->absDeadline <= OS_edfHeap[child]->absDeadline){
+				break;
+			}
+			OS_edfPlace(i, OS_edfHeap[child]);
+			i = child;
+		}
+		OS_edfPlace(i, t);
+	}
+
+	static OS_CCM_CODE void OS_edfInsert(OSThread *t) {
+		OS_edfHeap[OS_edfCount] = t;
+		OS_edfCount++;
+		OS_edfUp((uint16_t)(OS_edfCount - 1U));
+	}
+
+	static OS_CCM_CODE void OS_edfRemove(OSThread *t) {
+		uint16_t const i = (uint16_t)(t->edfIdx - 1U);
+		t->edfIdx = 0U;
+		OS_edfCount--;
+		if(i != OS_edfCount){
+			/* the last entry fills the hole, then finds its place either way */
+			OSThread *last = OS_edfHeap[OS_edfCount];
+			OS_edfHeap[i] = last;
+			OS_edfUp(i);
+			OS_edfDown((uint16_t)(last->edfIdx - 1U));
+		}
+	}
+#endif
+
+	/* is the thread ready to run, at its current priority? */
+	static inline bool OS_isReady(OSThread const *t) {
+		return OS_setHas(&OS_readySet, t->prio) && (OS_prioTbl[t->prio] == t);
+	}
+
+	/* make a thread ready to run at its current priority */
+	static OS_CCM_CODE void OS_makeReady(OSThread *t) {
+		OS_prioTbl[t->prio] = t;
+		OS_setInsert(&OS_readySet, t->prio);
+#ifdef MIROS_EDF
+		if((t->period != 0U) && (t->edfIdx == 0U)){
+			OS_edfInsert(t);
+		}
+#endif
+#ifdef MIROS_PROFILE
+		if((t != OS_curr) && !t->responsePending){
+			t->readyStamp = OS_PORT_CYCLES();
+			t->responsePending = true;
+		}
+#endif
+	}
+
+	/* the thread stops being ready, it blocked or finished */
+	static OS_CCM_CODE void OS_makeUnready(OSThread *t) {
+		OS_setRemove(&OS_readySet, t->prio);
+#ifdef MIROS_EDF
+		if(t->edfIdx != 0U){
+			OS_edfRemove(t);
+		}
+#endif
+	}
+
+	/* insert a thread into the timeout list, O(number of delayed threads) */
+	static void OS_timeInsert(OSThread *t, uint32_t ticks) {
+		OSThread *prev = (OSThread *)0;
+		OSThread *next = OS_timeHead;
+		while((next != (OSThread *)0) && (next->timeout <= ticks)){
+			ticks -= next->timeout;
+			prev = next;
+			next = next->timeNext;
+		}
+		t->timeout = ticks;
+		t->timePrev = prev;
+		t->timeNext = next;
+		if(next != (OSThread *)0){
+			next->timeout -= ticks;	/* keep the following deltas unchanged in time */
+			next->timePrev = t;
+		}
+		if(prev != (OSThread *)0){
+			prev->timeNext = t;
+		}else{
+			OS_timeHead = t;
+		}
+	}
 
-	uint8_t OS_threadNum; /* number of threads started */
-	uint8_t OS_currIdx; /* current thread index for the circular array */
+	/* remove a thread from the timeout list before its timeout expired */
+	static OS_CCM_CODE void OS_timeRemove(OSThread *t) {
+		if((t->timePrev == (OSThread *)0) && (OS_timeHead != t)){
+			return; /* not in the list */
+		}
+		if(t->timeNext != (OSThread *)0){
+			t->timeNext->timeout += t->timeout; /* the successor keeps its expiry time */
+			t->timeNext->timePrev = t->timePrev;
+		}
+		if(t->timePrev != (OSThread *)0){
+			t->timePrev->timeNext = t->timeNext;
+		}else{
+			OS_timeHead = t->timeNext;
+		}
+		t->timeNext = (OSThread *)0;
+		t->timePrev = (OSThread *)0;
+	}
 
+	/* make expired threads at the head of the timeout list ready to run */
+	static OS_CCM_CODE void OS_timeExpire(void) {
+		while((OS_timeHead != (OSThread *)0) && (OS_timeHead->timeout == 0U)){
+			OSThread *t = OS_timeHead;
+			OS_timeHead = t->timeNext;
+			if(OS_timeHead != (OSThread *)0){
+				OS_timeHead->timePrev = (OSThread *)0;
+			}
+			t->timeNext = (OSThread *)0;
+
+			if(t->waitSet != (OSPrioSet *)0){
+				/* the thread gave up waiting */
+				OS_setRemove(t->waitSet, t->basePrio);
+				t->waitSet = (OSPrioSet *)0;
+				t->waitStatus = OS_TIMEOUT;
+			}
+			OS_makeReady(t);
+		}
+	}
+
+	/* insert a timer into the list of armed timers, O(number of armed timers) */
+	static void OS_timerInsert(OSTimer *t, uint32_t ticks) {
+		OSTimer **link = &OS_timerHead;
+		while((*link != (OSTimer *)0) && ((*link)->delta <= ticks)){
+			ticks -= (*link)->delta;
+			link = &(*link)->next;
+		}
+		t->delta = ticks;
+		t->next = *link;
+		if(t->next != (OSTimer *)0){
+			t->next->delta -= ticks;
+		}
+		*link = t;
+		t->armed = true;
+	}
+
+	/* remove an armed timer from the list before it expired */
+	static void OS_timerRemove(OSTimer *t) {
+		OSTimer **link = &OS_timerHead;
+		while(*link != t){
+			link = &(*link)->next;
+		}
+		if(t->next != (OSTimer *)0){
+			t->next->delta += t->delta;
+		}
+		*link = t->next;
+		t->next = (OSTimer *)0;
+		t->armed = false;
+	}
+
+	/* move the expired timers at the head of the list to the daemon,
+	* re-arming the periodic ones from their expiry tick
+	*/
+	static OS_CCM_CODE void OS_timerExpire(void) {
+		bool expired = false;
+		while((OS_timerHead != (OSTimer *)0) && (OS_timerHead->delta == 0U)){
+			OSTimer *t = OS_timerHead;
+			OS_timerHead = t->next;
+			t->next = (OSTimer *)0;
+			t->armed = false;
+			if(t->period != 0U){
+				OS_timerInsert(t, t->period);
+			}
+
+			/* a callback still pending from an earlier expiry absorbs this one */
+			if(!t->fired){
+				t->fired = true;
+				t->firedNext = (OSTimer *)0;
+				if(OS_firedTail != (OSTimer *)0){
+					OS_firedTail->firedNext = t;
+				}else{
+					OS_firedHead = t;
+				}
+				OS_firedTail = t;
+				expired = true;
+			}
+		}
+		/* the daemon drains the whole list on every wake-up, so one pending
+		* post covers any number of expiries and the count never wraps
+		*/
+		if(expired && (OS_timerSem.value == 0U)){
+			OSSem_postFromISR(&OS_timerSem);
+		}
+	}
+
+	/* block the current thread in a waiting set, with an optional timeout
+	* (interrupts DISABLED); the switch happens once interrupts are enabled
+	*/
+	static OS_CCM_CODE void OS_block(OSPrioSet *waitSet, uint32_t timeout) {
+		/* never block the idleThread, nor a thread holding a resource */
+		Q_REQUIRE((OS_curr != OS_thread[0]) && (OS_curr != OS_ceilingHolder));
+
+		OS_setInsert(waitSet, OS_curr->basePrio);
+		OS_curr->waitSet = waitSet;
+		OS_curr->waitStatus = OS_OK;
+		OS_makeUnready(OS_curr);
+		if(timeout != OS_WAIT_FOREVER){
+			OS_timeInsert(OS_curr, timeout);
+		}
+		OS_sched();
+	}
+
+	/* wake up a thread blocked in a waiting set (interrupts DISABLED) */
+	static OS_CCM_CODE void OS_wake(OSThread *t) {
+		OS_setRemove(t->waitSet, t->basePrio);
+		t->waitSet = (OSPrioSet *)0;
+		OS_timeRemove(t);
+		OS_makeReady(t);
+	}
+
+	/* wake up the highest-priority thread of a non-empty waiting set
+	* (interrupts DISABLED)
+	*/
+	static OS_CCM_CODE OSThread *OS_wakeOne(OSPrioSet *waitSet) {
+		OSThread *t = OS_thread[OS_setFindMax(waitSet)];
+		OS_wake(t);
+		return t;
+	}
+
+	/* raise the system ceiling for a resource held by the given thread */
+	static void OS_resClaim(OSResource *res, OSThread *holder) {
+		res->prevCeiling = OS_ceiling;
+		res->prevHolder = OS_ceilingHolder;
+		if(res->ceiling > OS_ceiling){
+			OS_ceiling = res->ceiling;
+		}
+		OS_ceilingHolder = holder;
+	}
+
+	/* restore the system ceiling, resources are released in LIFO order */
+	static void OS_resRelease(OSResource *res) {
+		OS_ceiling = res->prevCeiling;
+		OS_ceilingHolder = res->prevHolder;
+	}
+
+	/* record the stack bounds used by OSThread_stackHighWater() and the stack guard */
+	static void OS_stackBounds(OSThread *me, uint32_t *bottom, uint32_t *top) {
+		me->stkLimit = OS_portGuard(me, bottom, top);
+		me->stkTop = top;
+	}
+
+#ifdef MIROS_TIMESLICE
+	/* next ready priority of a level after its turn, wrapping around from
+	* lo to hi; the turn itself when it is the only ready one
+	*/
+	static OS_CCM_CODE uint16_t OS_levelNext(OSLevel const *lv) {
+		uint16_t prio = OS_setFindBelow(&OS_readySet, lv->turn);
+		if(prio < lv->lo){
+			prio = OS_setFindBelow(&OS_readySet, lv->hi + 1U);
+		}
+		return prio;
+	}
+
+	/* the thread of the level to run, called by OS_sched() when the highest
+	* ready priority belongs to the level
+	*/
+	static OS_CCM_CODE OSThread *OS_levelPick(OSLevel *lv) {
+		if(!OS_setHas(&OS_readySet, lv->turn)){
+			/* the thread whose turn it was blocked, the next one starts afresh */
+			lv->turn = OS_levelNext(lv);
+			lv->slice = lv->quantum;
+		}
+		return OS_prioTbl[lv->turn];
+	}
+
+	/* count down the turn of the running level only; when it runs out, the
+	* turn passes on and the OS_sched() that follows the tick switches
+	*/
+	static OS_CCM_CODE void OS_levelTick(void) {
+		OSThread *t = OS_curr;
+		if(t == (OSThread *)0){
+			return; /* between a run-to-completion thread and its successor */
+		}
+		OSLevel *lv = OS_level[t->prio];
+		if((lv != (OSLevel *)0) && (lv->turn == t->prio)){
+			lv->slice--;
+			if(lv->slice == 0U){
+				lv->slice = lv->quantum;
+				lv->turn = OS_levelNext(lv);
+			}
+		}
+	}
+
+	void OSLevel_init(OSLevel *me, uint16_t lo, uint16_t hi, uint32_t quantum){
+		Q_REQUIRE((lo > 0U) && (lo <= hi) && (hi < Q_DIM(OS_level)) && (quantum != 0U));
+
+		me->lo = lo;
+		me->hi = hi;
+		me->turn = hi;
+		me->quantum = quantum;
+		me->slice = quantum;
+		for(uint16_t prio = lo; prio <= hi; prio++){
+			Q_REQUIRE(OS_level[prio] == (OSLevel *)0);
+			OS_level[prio] = me;
+		}
+	}
+#endif
 
 	OSThread idleThread;
 	void main_idleThread(){
@@ -54,220 +499,929 @@ namespace rtos{
 	}
 
 	void OS_init(void *stkSto, uint32_t stkSize) {
-		/* set the PendSV interrupt priority to the lowest level 0xFF */
-		*(uint32_t volatile *)0xE000ED20 |= (0xFFU << 16);
+		OS_portInit();
 
 		/* start idleThread thread */
-		OSThread_start(&idleThread, &main_idleThread, stkSto, stkSize);
+		OSThread_start(&idleThread, 0U, &main_idleThread, stkSto, stkSize);
 	}
 
-	void OS_sched(void) {
-		if(OS_readySet == 0U){ /* idle condition? */
-			OS_currIdx = 0U; /* the idle thread */
+	OS_CCM_CODE void OS_sched(void) {
+#ifdef MIROS_PROFILE
+		uint32_t const start = OS_PORT_CYCLES();
+#endif
+		OSThread *next;
+		uint16_t const prio = OS_setFindMax(&OS_readySet);
+
+		/* a thread that blocked gives up its preemption threshold */
+		while((OS_threshTop != (OSThread *)0) && !OS_isReady(OS_threshTop)){
+			OS_threshTop->threshHeld = false;
+			OS_threshTop = OS_threshTop->threshPrev;
+		}
+
+		if(prio == 0U){ /* idle condition? */
+			next = OS_prioTbl[0]; /* the idle thread */
 		}else{
-			do{ /* find the next ready thread*/
-				OS_currIdx++;
-				if(OS_currIdx == OS_threadNum){
-					OS_currIdx = 1;
+			if(prio <= OS_ceiling){
+				/* SRP: below the system ceiling only the holder may run */
+				next = OS_ceilingHolder;
+			}else if((OS_threshTop != (OSThread *)0) && (prio <= OS_threshTop->threshold)){
+				/* nothing ready above the threshold of the preempted thread */
+				next = OS_threshTop;
+			}else{
+				/* the highest-priority ready thread, independent of the thread count */
+				next = OS_prioTbl[prio];
+#ifdef MIROS_EDF
+				if((prio >= OS_edfLo) && (prio <= OS_edfHi) && (next == OS_thread[prio]) && (OS_edfCount != 0U)){
+					/* the EDF band: the earliest deadline, an inherited priority aside */
+					next = OS_edfHeap[0];
+				}
+#endif
+#ifdef MIROS_TIMESLICE
+				if(OS_level[prio] != (OSLevel *)0){
+					next = OS_levelPick(OS_level[prio]);
 				}
-				OS_next = OS_thread[OS_currIdx];
-			}while((OS_readySet & (1U <<(OS_currIdx - 1U))) == 0 );
+#endif
+				if(next->sharedStack != (OSSharedStack *)0){
+					/* a run-to-completion thread starts afresh on top of its
+					* stack and holds the stack until it returns
+					*/
+					OS_resClaim(&next->sharedStack->res, next);
+					next->sp = OS_portFrame(next->sharedStack->bottom, next->sharedStack->top, next->handler, true);
+				}
+				if((next->threshold > next->prio) && !next->threshHeld){
+					/* the threshold is in force from the switch on */
+					next->threshHeld = true;
+					next->threshPrev = OS_threshTop;
+					OS_threshTop = next;
+				}
+			}
+			Q_ASSERT(next != (OSThread *)0);
 		}
-		OS_next = OS_thread[OS_currIdx];
 
-		/* trigger PendSV, if needed */
-		if(OS_next != OS_curr){
-			*(uint32_t volatile *)0xE000ED04 = (1U << 28);
+		/* trigger the switch (PendSV), if needed */
+		if(next != OS_curr){
+			OS_next = next;
+			OS_portPend();
 		}
+#ifdef MIROS_PROFILE
+		uint32_t const cycles = OS_PORT_CYCLES() - start;
+		if(cycles > OS_schedMaxCycles){
+			OS_schedMaxCycles = cycles;
+		}
+#endif
 	}
 
 	void OS_run(void) {
 		/* callback to configure and start interrupts */
 		OS_onStartup();
 
-		__disable_irq();
+		OS_portRun();
+
+		uint32_t crit = OS_critEnter();
 		OS_sched();
-		__enable_irq();
+		OS_critExit(crit);
 
 		/* the following code should never execute */
 		Q_ERROR();
 	}
 
-	void OS_tick(void) {
-		uint8_t n = 0;
-		for(n=1U;n<OS_threadNum; n++){ 				/* cycle through every thread but the idle */
-			if(OS_thread[n]->timeout != 0U){
-				OS_thread[n]->timeout--;			/* decrease the timeout */
-				if(OS_thread[n]->timeout == 0U){
-					OS_readySet |= (1U << (n-1U));	/* if the thread is ready mask the corresponding bit */
-				}
+	OS_CCM_CODE void OS_tick(void) {
+#ifdef MIROS_PROFILE
+		uint32_t const start = OS_PORT_CYCLES();
+#endif
+		OS_tickCtr++;
+		OS_TRACE(OS_EVT_TICK, 0U, OS_tickCtr);
+#ifdef MIROS_PROFILE
+		OS_runAccount(start);
+#endif
+#ifdef MIROS_TIMESLICE
+		OS_levelTick();
+#endif
+		if(OS_timeHead != (OSThread *)0){
+			OS_timeHead->timeout--;					/* only the nearest timeout counts down */
+			OS_timeExpire();
+		}
+		if(OS_timerHead != (OSTimer *)0){
+			OS_timerHead->delta--;					/* likewise for the nearest timer */
+			OS_timerExpire();
+		}
+#ifdef MIROS_PROFILE
+		uint32_t const cycles = OS_PORT_CYCLES() - start;
+		if(cycles > OS_tickMaxCycles){
+			OS_tickMaxCycles = cycles;
+		}
+#endif
+	}
+
+#if defined(MIROS_PROFILE) || defined(MIROS_TRACE)
+	OS_CCM_CODE void OS_switchHook(void) {
+#ifdef MIROS_PROFILE
+		uint32_t const now = OS_PORT_CYCLES();
+		if(OS_bootCycles == 0U){
+			OS_bootCycles = now;				/* the first switch ends the boot */
+		}
+		OS_runAccount(now);
+		OS_running = OS_curr;
+		OS_curr->switches++;
+		if(OS_curr->responsePending){
+			uint32_t response = now - OS_curr->readyStamp;
+			if(response > OS_curr->maxResponse){
+				OS_curr->maxResponse = response;
 			}
+			OS_curr->responsePending = false;
+		}
+#endif
+#ifdef MIROS_TRACE
+		OS_traceSwitch();
+#endif
+	}
+#endif
+
+#ifdef MIROS_PROFILE
+	uint16_t OS_getStats(OSThreadStats stats[], uint16_t maxCount){
+		uint32_t crit = OS_critEnter();
+
+		OS_runAccount(OS_PORT_CYCLES());					/* include the current run */
+
+		uint64_t total = 0U;
+		for(uint16_t prio = 0U; prio < Q_DIM(OS_thread); prio++){
+			if(OS_thread[prio] != (OSThread *)0){
+				total += OS_thread[prio]->runCycles;
+			}
+		}
+
+		uint16_t n = 0U;
+		for(uint16_t prio = 0U; (prio < Q_DIM(OS_thread)) && (n < maxCount); prio++){
+			OSThread *t = OS_thread[prio];
+			if(t != (OSThread *)0){
+				stats[n].thread = t;
+				stats[n].runCycles = t->runCycles;
+				stats[n].switches = t->switches;
+				stats[n].maxResponse = t->maxResponse;
+				stats[n].cpu = (total != 0U) ? (uint16_t)((t->runCycles * 10000U) / total) : 0U;
+				n++;
+			}
+		}
+
+		OS_critExit(crit);
+		return n;
+	}
+#endif
+
+	uint32_t OS_idleTicks(void) {
+		uint32_t ticks = (OS_timeHead != (OSThread *)0) ? OS_timeHead->timeout : 0U;
+		if((OS_timerHead != (OSTimer *)0) && ((ticks == 0U) || (OS_timerHead->delta < ticks))){
+			ticks = OS_timerHead->delta;
+		}
+		return ticks;
+	}
+
+	void OS_tickAdvance(uint32_t ticks) {
+		uint32_t timerTicks = ticks;
+		OS_tickCtr += ticks;
+		OSThread *t = OS_timeHead;
+		while((t != (OSThread *)0) && (ticks >= t->timeout)){
+			ticks -= t->timeout;					/* make up for the skipped ticks */
+			t->timeout = 0U;
+			t = t->timeNext;
+		}
+		if(t != (OSThread *)0){
+			t->timeout -= ticks;
+		}
+		OS_timeExpire();
+
+		/* the timers one expiry at a time, so periodic ones re-arm in step */
+		while((timerTicks != 0U) && (OS_timerHead != (OSTimer *)0)){
+			uint32_t step = (timerTicks < OS_timerHead->delta) ? timerTicks : OS_timerHead->delta;
+			OS_timerHead->delta -= step;
+			timerTicks -= step;
+			OS_timerExpire();
 		}
 	}
 
 	void OS_delay(uint32_t ticks) {
-		__asm volatile ("cpsid i");
+		uint32_t crit = OS_critEnter();
 
-		/* never call OS_delay from the idleThread */
-		Q_REQUIRE(OS_curr != OS_thread[0]);
+		/* never call OS_delay from the idleThread, nor with zero ticks,
+		* nor while holding a resource
+		*/
+		Q_REQUIRE((OS_curr != OS_thread[0]) && (ticks != 0U) && (OS_curr != OS_ceilingHolder));
 
-		OS_curr->timeout = ticks;
-		OS_readySet &= ~(1U << (OS_currIdx - 1U));
+		OS_timeInsert(OS_curr, ticks);
+		OS_makeUnready(OS_curr);
 		OS_sched();
-		__asm volatile ("cpsie i");
+		OS_critExit(crit);
 	 }
 
-	void OSThread_start(OSThread *me, OSThreadHandler threadHandler, void *stkSto, uint32_t stkSize){
+	uint64_t OS_getTicks(void) {
+		/* the 64-bit counter takes two loads, keep the tick out in between */
+		uint32_t crit = OS_critEnter();
+		uint64_t ticks = OS_tickCtr;
+		OS_critExit(crit);
+		return ticks;
+	}
+
+	bool OS_delayUntil(uint64_t *lastWake, uint32_t period) {
+		Q_REQUIRE(period != 0U);
+
+		uint32_t crit = OS_critEnter();
+
+		/* same restrictions as OS_delay() */
+		Q_REQUIRE((OS_curr != OS_thread[0]) && (OS_curr != OS_ceilingHolder));
+
+		uint64_t release = *lastWake + period;
+		*lastWake = release;
+		bool onTime = (release > OS_tickCtr);
+		if(onTime){
+			OS_timeInsert(OS_curr, (uint32_t)(release - OS_tickCtr));
+			OS_makeUnready(OS_curr);
+			OS_sched();
+		}
+
+		OS_critExit(crit);
+		return onTime;
+	}
+
+#ifdef MIROS_EDF
+	void OS_edfInit(uint16_t lo, uint16_t hi) {
+		Q_REQUIRE((lo > 0U) && (lo <= hi) && (hi < Q_DIM(OS_thread)) && (OS_edfHi == 0U));
+#ifdef MIROS_TIMESLICE
+		for(uint16_t prio = lo; prio <= hi; prio++){
+			Q_REQUIRE(OS_level[prio] == (OSLevel *)0); /* a band is either sliced or EDF */
+		}
+#endif
+		OS_edfLo = lo;
+		OS_edfHi = hi;
+	}
+
+	void OSThread_setEdf(OSThread *me, uint32_t period, uint32_t deadline) {
+		uint32_t crit = OS_critEnter();
+
+		Q_REQUIRE((period != 0U) && (deadline != 0U) && (deadline <= period)
+			&& (me->basePrio >= OS_edfLo) && (me->basePrio <= OS_edfHi) && (me->sharedStack == (OSSharedStack *)0));
+
+		if(me->edfIdx != 0U){
+			OS_edfRemove(me);					/* the key changes */
+		}
+		me->period = period;
+		me->relDeadline = deadline;
+		me->release = OS_tickCtr;
+		me->absDeadline = OS_tickCtr + deadline;
+		if(OS_isReady(me)){
+			OS_edfInsert(me);
+		}
+		if(OS_curr != (OSThread *)0){			/* nothing to reschedule before OS_run() */
+			OS_sched();
+		}
+
+		OS_critExit(crit);
+	}
+
+	bool OS_edfNextPeriod(void) {
+		uint32_t crit = OS_critEnter();
+
+		/* same restrictions as OS_delay() */
+		Q_REQUIRE((OS_curr->period != 0U) && (OS_curr != OS_ceilingHolder));
+
+		OSThread *me = OS_curr;
+		bool const onTime = (OS_tickCtr <= me->absDeadline);
+
+		/* the next job, its deadline is the new key in the heap */
+		OS_edfRemove(me);
+		me->release += me->period;
+		me->absDeadline = me->release + me->relDeadline;
+		if(me->release > OS_tickCtr){
+			OS_timeInsert(me, (uint32_t)(me->release - OS_tickCtr));
+			OS_setRemove(&OS_readySet, me->prio);
+		}else{
+			OS_edfInsert(me);					/* released already, runs late */
+		}
+		OS_sched();
+
+		OS_critExit(crit);
+		return onTime;
+	}
+#endif
+
+	void OSThread_start(OSThread *me, uint16_t prio, OSThreadHandler threadHandler, void *stkSto, uint32_t stkSize){
 		/* round down the stack top to the 8-byte boundary
-		* NOTE: ARM Cortex-M stack grows down from hi -> low memory
+		* NOTE: the stack grows down from hi -> low memory
 		*/
-		uint32_t *sp = (uint32_t *)((((uint32_t)stkSto + stkSize) / 8) * 8);
+		uint32_t *stk_top = (uint32_t *)((((uintptr_t)stkSto + stkSize) / 8) * 8);
 		uint32_t *stk_limit;
 
-		/* thread number must be in ragne
+		/* priority must be in range
 		* and must be unused
 		*/
-		Q_REQUIRE((OS_threadNum < Q_DIM(OS_thread)) && (OS_thread[OS_threadNum] == (OSThread *)0));
-
-		*(--sp) = (1U << 24);  /* xPSR */
-		*(--sp) = (uint32_t)threadHandler; /* PC */
-		*(--sp) = 0x0000000EU; /* LR  */
-		*(--sp) = 0x0000000CU; /* R12 */
-		*(--sp) = 0x00000003U; /* R3  */
-		*(--sp) = 0x00000002U; /* R2  */
-		*(--sp) = 0x00000001U; /* R1  */
-		*(--sp) = 0x00000000U; /* R0  */
-		/* additionally, fake registers R4-R11 */
-		*(--sp) = 0x0000000BU; /* R11 */
-		*(--sp) = 0x0000000AU; /* R10 */
-		*(--sp) = 0x00000009U; /* R9 */
-		*(--sp) = 0x00000008U; /* R8 */
-		*(--sp) = 0x00000007U; /* R7 */
-		*(--sp) = 0x00000006U; /* R6 */
-		*(--sp) = 0x00000005U; /* R5 */
-		*(--sp) = 0x00000004U; /* R4 */
-
-		/* save the top of the stack in the thread's attibute */
-		me->sp = sp;
+		Q_REQUIRE((prio < Q_DIM(OS_thread)) && (OS_thread[prio] == (OSThread *)0));
 
 		/* round up the bottom of the stack to the 8-byte boundary */
-		stk_limit = (uint32_t *)(((((uint32_t)stkSto - 1U) / 8) + 1U) * 8);
+		stk_limit = (uint32_t *)(((((uintptr_t)stkSto - 1U) / 8) + 1U) * 8);
 
-		/* pre-fill the unused part of the stack with 0xDEADBEEF */
-		for (sp = sp - 1U; sp >= stk_limit; --sp) {
+		/* pre-fill the stack with 0xDEADBEEF */
+		for (uint32_t *sp = stk_top - 1U; sp >= stk_limit; --sp) {
 			*sp = 0xDEADBEEFU;
 		}
 
+		/* save the top of the initial context in the thread's attibute */
+		me->sp = OS_portFrame(stk_limit, stk_top, threadHandler, false);
+		OS_stackBounds(me, stk_limit, stk_top);
+
 		/* register the thread with the OS */
-		OS_thread[OS_threadNum] = me;
+		me->prio = prio;
+		me->basePrio = prio;
+		me->threshold = prio;
+		me->threshHeld = false;
+#ifdef MIROS_EDF
+		me->period = 0U;
+		me->edfIdx = 0U;
+#endif
+		me->waitSet = (OSPrioSet *)0;
+		me->waitMutex = (OSMutex *)0;
+		me->heldMutex = (OSMutex *)0;
+		me->handler = threadHandler;
+		me->sharedStack = (OSSharedStack *)0;
+		OS_thread[prio] = me;
+		OS_prioTbl[prio] = me;
 		/* make the thread ready to run */
-		if (OS_threadNum > 0U) {
-			OS_readySet |= (1U << (OS_threadNum - 1U));
+		if (prio > 0U) {
+			OS_setInsert(&OS_readySet, prio);
+		}
+	}
+
+	void OSThread_register(OSThread * const threads[], uint16_t n, OSPrioSet const *ready){
+		for(uint16_t i = 0U; i < n; i++){
+			OSThread *t = threads[i];
+
+			/* the compiler checked the priorities among these threads only */
+			Q_REQUIRE(OS_thread[t->prio] == (OSThread *)0);
+
+			OS_stackBounds(t, t->stkLimit, t->stkTop);
+			OS_thread[t->prio] = t;
+			OS_prioTbl[t->prio] = t;
+		}
+
+		/* make them all ready at once */
+		OS_readySet.groups |= ready->groups;
+		for(uint32_t g = 0U; g < Q_DIM(ready->bits); g++){
+			OS_readySet.bits[g] |= ready->bits[g];
+		}
+	}
+
+	void OSThread_startRtc(OSThread *me, uint16_t prio, OSThreadHandler threadHandler, OSSharedStack *stk){
+		/* priority must be in range
+		* and must be unused
+		*/
+		Q_REQUIRE((prio > 0U) && (prio < Q_DIM(OS_thread)) && (OS_thread[prio] == (OSThread *)0));
+
+		/* the initial frame is built each time the thread is dispatched */
+		me->sp = (void *)0;
+		me->prio = prio;
+		me->basePrio = prio;
+		me->threshold = prio;
+		me->threshHeld = false;
+		me->waitSet = (OSPrioSet *)0;
+		me->waitMutex = (OSMutex *)0;
+		me->heldMutex = (OSMutex *)0;
+		me->handler = threadHandler;
+		me->sharedStack = stk;
+		OS_stackBounds(me, stk->bottom, stk->top);
+		OS_thread[prio] = me;
+		OS_prioTbl[prio] = me;
+
+		/* the stack ceiling is the highest priority among its users */
+		if(prio > stk->res.ceiling){
+			stk->res.ceiling = prio;
 		}
-		OS_threadNum++;
 	}
-	/***********************************************/
-	void OS_onStartup(void) {
-		SystemCoreClockUpdate();
-		SysTick_Config(SystemCoreClock / TICKS_PER_SEC);
 
-		/* set the SysTick interrupt priority (highest) */
-		NVIC_SetPriority(SysTick_IRQn, 0U);
+	void OSThread_setThreshold(OSThread *me, uint16_t threshold){
+		uint32_t crit = OS_critEnter();
+
+		Q_REQUIRE((threshold >= me->basePrio) && (threshold < Q_DIM(OS_thread)));
+
+		me->threshold = threshold;
+		if(OS_curr != (OSThread *)0){			/* nothing to reschedule before OS_run() */
+			OS_sched();							/* a lower threshold may let a waiting thread in */
+		}
+
+		OS_critExit(crit);
 	}
 
-	void OS_onIdle(void) {
-		#ifdef NDBEBUG
-			__WFI(); /* stop the CPU and Wait for Interrupt */
-		#endif
+	void OSThread_activate(OSThread *me){
+		uint32_t crit = OS_critEnter();
+
+		Q_REQUIRE(me->sharedStack != (OSSharedStack *)0);
+
+		OS_makeReady(me);
+		OS_sched();
+
+		OS_critExit(crit);
+	}
+
+	/* end of a run-to-completion activation, entered on the system stack with
+	* interrupts DISABLED; the context on the shared stack is dead, so it is
+	* not saved by the switch
+	*/
+	void OS_rtcPark(void) {
+		OSThread *me = OS_curr;
+		OS_resRelease(&me->sharedStack->res);
+		OS_makeUnready(me);
+		OS_curr = (OSThread *)0;
+		OS_sched();
+	}
+
+	void OSSharedStack_init(OSSharedStack *me, void *stkSto, uint32_t stkSize){
+		/* round down the stack top to the 8-byte boundary */
+		me->top = (uint32_t *)((((uintptr_t)stkSto + stkSize) / 8) * 8);
+		/* round up the bottom of the stack to the 8-byte boundary */
+		me->bottom = (uint32_t *)(((((uintptr_t)stkSto - 1U) / 8) + 1U) * 8);
+		me->res.ceiling = 0U;
+
+		/* pre-fill the stack with 0xDEADBEEF */
+		for (uint32_t *sp = me->top - 1U; sp >= me->bottom; --sp) {
+			*sp = 0xDEADBEEFU;
+		}
+	}
+
+	uint32_t OSThread_stackHighWater(OSThread const *me){
+		/* the first overwritten word from the bottom marks the deepest use */
+		uint32_t const *sp = me->stkLimit;
+		while((sp < me->stkTop) && (*sp == 0xDEADBEEFU)){
+			++sp;
+		}
+		return (uint32_t)(me->stkTop - sp);
+	}
+
+	uint16_t OS_stackStats(OSStackStats stats[], uint16_t maxCount){
+		uint16_t n = 0U;
+		for(uint16_t prio = 0U; (prio < Q_DIM(OS_thread)) && (n < maxCount); prio++){
+			OSThread *t = OS_thread[prio];
+			if(t != (OSThread *)0){
+				stats[n].thread = t;
+				stats[n].size = (uint32_t)(t->stkTop - t->stkLimit);
+				stats[n].used = OSThread_stackHighWater(t);
+				n++;
+			}
+		}
+		return n;
+	}
+
+	void OSResource_init(OSResource *me, OSThread * const users[], uint16_t nUsers){
+		me->ceiling = 0U;
+		for(uint16_t n = 0U; n < nUsers; n++){
+			Q_REQUIRE(users[n]->basePrio != 0U);
+			if(users[n]->basePrio > me->ceiling){
+				me->ceiling = users[n]->basePrio;
+			}
+		}
+	}
+
+	void OSResource_lock(OSResource *me){
+		uint32_t crit = OS_critEnter();
+		OS_resClaim(me, OS_curr);
+		OS_critExit(crit);
+	}
+
+	void OSResource_unlock(OSResource *me){
+		uint32_t crit = OS_critEnter();
+
+		Q_REQUIRE(OS_ceilingHolder == OS_curr);
+
+		OS_resRelease(me);
+		OS_sched();								/* threads below the old ceiling may run now */
+
+		OS_critExit(crit);
 	}
 
 	void OSSem_init(OSSem *me, uint8_t initialValue){
 		me->value = initialValue;								//Initializes the value with the initial value of semaphore
-		me->waitingSet = 0U;									//Initializes empty
+		OS_setClear(&me->waitingSet);							//Initializes empty
 	}
 
-	void OSSem_pend(OSSem *me){
-		__disable_irq();                                        //Activate do not disturb mode
+	OS_CCM_CODE OSStatus OSSem_pend(OSSem *me, uint32_t timeout){
+		uint32_t crit = OS_critEnter();                         //Activate do not disturb mode
 
 		if(me->value > 0){
 			me->value--;										//Decrements the value by one
-		}else{
-			me->waitingSet |= (1U << (OS_currIdx - 1U));		//Puts the current task in the waiting list of the semaphore
-			OS_readySet &= ~(1U << (OS_currIdx - 1U));			//Puts the current task on hold
-			OS_sched();											//Calls the scheduler to call the next task
+			OS_TRACE(OS_EVT_SEM_PEND, OS_PEND_TAKEN, OS_TRACE_OBJ(me));
+			OS_critExit(crit);
+			return OS_OK;
 		}
 
-		__enable_irq();											//Deactivate do not disturb mode
+		OS_TRACE(OS_EVT_SEM_PEND, OS_PEND_BLOCKED, OS_TRACE_OBJ(me));
+		OS_block(&me->waitingSet, timeout);						//Waits in the semaphore's waiting list
+		OS_critExit(crit);											//Deactivate do not disturb mode, blocks here
+
+		OS_TRACE(OS_EVT_SEM_PEND, (OS_curr->waitStatus == OS_OK) ? OS_PEND_WOKEN : OS_PEND_TIMEOUT, OS_TRACE_OBJ(me));
+		return OS_curr->waitStatus;								//OS_TIMEOUT when the tick expired the wait
 	}
 
-	void OSSem_post(OSSem *me){
-		__disable_irq();                                        //Activate do not disturb mode
+	OS_CCM_CODE void OSSem_post(OSSem *me){
+		uint32_t crit = OS_critEnter();                         //Activate do not disturb mode
 
-		if(me->waitingSet == 0){
+		OS_TRACE(OS_EVT_SEM_POST, (me->waitingSet.groups != 0U) ? 1U : 0U, OS_TRACE_OBJ(me));
+		if(me->waitingSet.groups == 0U){
 			me->value++;										//Increments the value by one
 		}else{
-			uint8_t i = 0;
-			while((me->waitingSet & (1U << i)) == 0){			//Goes through the bitmask positions until it finds a task waiting
-				i++;
+			(void)OS_wakeOne(&me->waitingSet);					//Hands the unit straight to the highest-priority waiter
+			OS_sched();											//Preempts right after the do not disturb mode ends
+		}
+
+		OS_critExit(crit);											//Deactivate do not disturb mode
+	}
+
+	OS_CCM_CODE void OSSem_postFromISR(OSSem *me){
+		uint32_t crit = OS_critEnter();				//The ISR may run inside a critical section
+
+		OS_TRACE(OS_EVT_SEM_POST, (me->waitingSet.groups != 0U) ? 1U : 0U, OS_TRACE_OBJ(me));
+		if(me->waitingSet.groups == 0U){
+			me->value++;
+		}else{
+			(void)OS_wakeOne(&me->waitingSet);
+			OS_sched();											//Switches on exit from the ISR
+		}
+
+		OS_critExit(crit);
+	}
+
+	void OSQueue_init(OSQueue *me, void *ringSto[], uint16_t size){
+		Q_REQUIRE(size != 0U);
+		me->ring = ringSto;
+		me->size = size;
+		me->count = 0U;
+		me->head = 0U;
+		me->tail = 0U;
+		OS_setClear(&me->getWaitSet);
+		OS_setClear(&me->postWaitSet);
+	}
+
+	/* queue a pointer or hand it straight to a waiting thread (interrupts DISABLED) */
+	static bool OSQueue_put(OSQueue *me, void *msg){
+		if(me->getWaitSet.groups != 0U){
+			OS_wakeOne(&me->getWaitSet)->waitMsg = msg;	//Direct hand-over, the queue stays empty
+		}else if(me->count < me->size){
+			me->ring[me->tail] = msg;
+			me->tail = (me->tail + 1U == me->size) ? 0U : (me->tail + 1U);
+			me->count++;
+		}else{
+			return false;
+		}
+		return true;
+	}
+
+	OSStatus OSQueue_post(OSQueue *me, void *msg, uint32_t timeout){
+		uint32_t crit = OS_critEnter();
+
+		if(OSQueue_put(me, msg)){
+			OS_sched();
+			OS_critExit(crit);
+			return OS_OK;
+		}
+
+		OS_curr->waitMsg = msg;									//OSQueue_get moves it into the ring
+		OS_block(&me->postWaitSet, timeout);
+		OS_critExit(crit);											//Blocks here
+
+		return OS_curr->waitStatus;
+	}
+
+	bool OSQueue_postFromISR(OSQueue *me, void *msg){
+		uint32_t crit = OS_critEnter();
+
+		bool posted = OSQueue_put(me, msg);
+		if(posted){
+			OS_sched();											//Switches on exit from the ISR
+		}
+
+		OS_critExit(crit);
+		return posted;
+	}
+
+	OSStatus OSQueue_get(OSQueue *me, void **msg, uint32_t timeout){
+		uint32_t crit = OS_critEnter();
+
+		if(me->count != 0U){
+			*msg = me->ring[me->head];
+			me->head = (me->head + 1U == me->size) ? 0U : (me->head + 1U);
+			me->count--;
+
+			if(me->postWaitSet.groups != 0U){
+				/* the freed slot goes to the highest-priority blocked poster */
+				OSQueue_put(me, OS_wakeOne(&me->postWaitSet)->waitMsg);
+				OS_sched();
 			}
+			OS_critExit(crit);
+			return OS_OK;
+		}
+
+		OS_block(&me->getWaitSet, timeout);
+		OS_critExit(crit);											//Blocks here
 
-			me->waitingSet &= ~(1U << i);						//Removes the task from the waiting list
-			OS_readySet |= (1U << i);							//Puts the current task in the ready list
+		if(OS_curr->waitStatus == OS_OK){
+			*msg = OS_curr->waitMsg;
 		}
+		return OS_curr->waitStatus;
+	}
 
-		__enable_irq();											//Deactivate do not disturb mode
+	/* does the flag word satisfy the wait of the given mask and options? */
+	static bool OSEventFlags_match(uint32_t flags, uint32_t mask, uint8_t options){
+		return ((options & OS_FLAGS_ALL) != 0U) ? ((flags & mask) == mask) : ((flags & mask) != 0U);
 	}
 
-}//fim namespace
+	void OSEventFlags_init(OSEventFlags *me, uint32_t initialFlags){
+		me->flags = initialFlags;
+		OS_setClear(&me->waitingSet);
+	}
+
+	OSStatus OSEventFlags_wait(OSEventFlags *me, uint32_t mask, uint8_t options, uint32_t timeout, uint32_t *matched){
+		Q_REQUIRE(mask != 0U);
+
+		uint32_t crit = OS_critEnter();
+
+		if(OSEventFlags_match(me->flags, mask, options)){
+			uint32_t hit = me->flags & mask;
+			if((options & OS_FLAGS_CLEAR) != 0U){
+				me->flags &= ~hit;
+			}
+			OS_critExit(crit);
+
+			if(matched != (uint32_t *)0){
+				*matched = hit;
+			}
+			return OS_OK;
+		}
+
+		OS_curr->waitFlags = mask;
+		OS_curr->waitOpts = options;
+		OS_block(&me->waitingSet, timeout);
+		OS_critExit(crit);											//Blocks here
+
+		if((OS_curr->waitStatus == OS_OK) && (matched != (uint32_t *)0)){
+			*matched = OS_curr->waitFlags;						//Set by OSEventFlags_set
+		}
+		return OS_curr->waitStatus;
+	}
+
+	void OSEventFlags_set(OSEventFlags *me, uint32_t flags){
+		uint32_t crit = OS_critEnter();
+
+		me->flags |= flags;
+
+		/* release every satisfied waiter in one pass over the waiting set, in
+		* place: waking a thread only clears its own bit, and the walk goes on
+		* below it
+		*/
+		uint32_t consumed = 0U;
+		for(uint16_t prio = OS_setFindMax(&me->waitingSet); prio != 0U; prio = OS_setFindBelow(&me->waitingSet, prio)){
+			OSThread *t = OS_thread[prio];
+			if(OSEventFlags_match(me->flags, t->waitFlags, t->waitOpts)){
+				t->waitFlags &= me->flags;						//Reports the flags that matched
+				if((t->waitOpts & OS_FLAGS_CLEAR) != 0U){
+					consumed |= t->waitFlags;
+				}
+				OS_wake(t);
+			}
+		}
+		me->flags &= ~consumed;
+		OS_sched();
+
+		OS_critExit(crit);
+	}
+
+	void OSEventFlags_clear(OSEventFlags *me, uint32_t flags){
+		uint32_t crit = OS_critEnter();
+		me->flags &= ~flags;
+		OS_critExit(crit);
+	}
+
+	void OSTimer_init(OSTimer *me, OSTimerHandler handler, void *arg){
+		me->next = (OSTimer *)0;
+		me->firedNext = (OSTimer *)0;
+		me->delta = 0U;
+		me->period = 0U;
+		me->handler = handler;
+		me->arg = arg;
+		me->armed = false;
+		me->fired = false;
+	}
+
+	void OSTimer_start(OSTimer *me, uint32_t ticks, uint32_t period){
+		Q_REQUIRE(ticks != 0U);
+
+		uint32_t crit = OS_critEnter();
 
-void Q_onAssert(char const *module, int loc) {
-    /* TBD: damage control */
-    (void)module; /* avoid the "unused parameter" compiler warning */
-    (void)loc;    /* avoid the "unused parameter" compiler warning */
-    NVIC_SystemReset();
-}
-
-/***********************************************/
-__attribute__ ((naked, optimize("-fno-stack-protector")))
-void PendSV_Handler(void) {
-	__asm volatile(
-
-		/* __disable_irq(); */
-		"  CPSID         I                 \n"
-
-		/* if (OS_curr != (OSThread *)0) { */
-		"  LDR           r1,=_ZN4rtos7OS_currE       \n"
-		"  LDR           r1,[r1,#0x00]     \n"
-		"  CBZ           r1,PendSV_restore \n"
-
-		/*     push registers r4-r11 on the stack */
-		"  PUSH          {r4-r11}          \n"
-
-		/*     OS_curr->sp = sp; */
-		"  LDR           r1,=_ZN4rtos7OS_currE       \n"
-		"  LDR           r1,[r1,#0x00]     \n"
-		"  STR           sp,[r1,#0x00]     \n"
-		/* } */
-
-		"PendSV_restore:                   \n"
-		/* sp = OS_next->sp; */
-		"  LDR           r1,=_ZN4rtos7OS_nextE       \n"
-		"  LDR           r1,[r1,#0x00]     \n"
-		"  LDR           sp,[r1,#0x00]     \n"
-
-		/* OS_curr = OS_next; */
-		"  LDR           r1,=_ZN4rtos7OS_nextE       \n"
-		"  LDR           r1,[r1,#0x00]     \n"
-		"  LDR           r2,=_ZN4rtos7OS_currE       \n"
-		"  STR           r1,[r2,#0x00]     \n"
-
-		/* pop registers r4-r11 */
-		"  POP           {r4-r11}          \n"
-
-		/* __enable_irq(); */
-		"  CPSIE         I                 \n"
-
-		/* return to the next thread */
-		"  BX            lr                \n"
-		);
-}
+		if(me->armed){
+			OS_timerRemove(me);
+		}
+		me->period = period;
+		OS_timerInsert(me, ticks);
+
+		OS_critExit(crit);
+	}
+
+	void OSTimer_stop(OSTimer *me){
+		uint32_t crit = OS_critEnter();
+
+		if(me->armed){
+			OS_timerRemove(me);
+		}
+		if(me->fired){
+			/* unlink the pending callback */
+			OSTimer *prev = (OSTimer *)0;
+			OSTimer **link = &OS_firedHead;
+			while(*link != me){
+				prev = *link;
+				link = &(*link)->firedNext;
+			}
+			*link = me->firedNext;
+			if(OS_firedTail == me){
+				OS_firedTail = prev;
+			}
+			me->fired = false;
+		}
+
+		OS_critExit(crit);
+	}
+
+	/* runs the callbacks of the expired timers, in expiry order */
+	static void OS_timerDaemon(){
+		while(1){
+			(void)OSSem_pend(&OS_timerSem, OS_WAIT_FOREVER);
+
+			uint32_t crit = OS_critEnter();
+			while(OS_firedHead != (OSTimer *)0){
+				OSTimer *t = OS_firedHead;
+				OS_firedHead = t->firedNext;
+				if(OS_firedHead == (OSTimer *)0){
+					OS_firedTail = (OSTimer *)0;
+				}
+				t->fired = false;
+				OS_critExit(crit);
+
+				t->handler(t->arg);						/* callbacks run with interrupts enabled */
+
+				crit = OS_critEnter();
+			}
+			OS_critExit(crit);
+		}
+	}
+
+	void OS_timerInit(uint16_t prio, void *stkSto, uint32_t stkSize){
+		OSSem_init(&OS_timerSem, 0U);
+		OSThread_start(&OS_timerThread, prio, &OS_timerDaemon, stkSto, stkSize);
+	}
+
+	void OSPool_init(OSPool *me, void *poolSto, uint32_t poolSize, uint16_t blockSize){
+		/* every block must be able to hold the free-list link */
+		blockSize = (uint16_t)(((blockSize + sizeof(void *) - 1U) / sizeof(void *)) * sizeof(void *));
+		Q_REQUIRE((blockSize != 0U) && (poolSize >= blockSize));
+
+		me->freeList = (void *)0;
+		me->blockSize = blockSize;
+		me->nFree = 0U;
+		for(uint8_t *block = (uint8_t *)poolSto; block + blockSize <= (uint8_t *)poolSto + poolSize; block += blockSize){
+			*(void **)block = me->freeList;
+			me->freeList = block;
+			me->nFree++;
+		}
+	}
+
+	void *OSPool_get(OSPool *me){
+		uint32_t crit = OS_critEnter();
+
+		void *block = me->freeList;
+		if(block != (void *)0){
+			me->freeList = *(void **)block;
+			me->nFree--;
+		}
+
+		OS_critExit(crit);
+		return block;
+	}
+
+	void OSPool_put(OSPool *me, void *block){
+		uint32_t crit = OS_critEnter();
+
+		*(void **)block = me->freeList;
+		me->freeList = block;
+		me->nFree++;
+
+		OS_critExit(crit);
+	}
+
+	/* move a thread to another priority level, carrying its readiness along */
+	static void OS_prioMove(OSThread *t, uint16_t prio) {
+		if(t->prio == prio){
+			return;
+		}
+		if((OS_prioTbl[t->prio] == t) && OS_setHas(&OS_readySet, t->prio)){
+			/* give the old level back to the thread that was assigned to it */
+			OS_setRemove(&OS_readySet, t->prio);
+			OS_prioTbl[t->prio] = OS_thread[t->prio];
+			t->prio = prio;
+			OS_makeReady(t);
+		}else{
+			t->prio = prio; /* blocked threads take the new level when readied */
+		}
+	}
+
+	/* highest current priority among the threads waiting on a mutex, 0 if none */
+	static OSThread *OSMutex_topWaiter(OSMutex *me) {
+		OSThread *top = (OSThread *)0;
+		for(uint16_t prio = OS_setFindMax(&me->waitingSet); prio != 0U; prio = OS_setFindBelow(&me->waitingSet, prio)){
+			OSThread *t = OS_thread[prio];
+			if((top == (OSThread *)0) || (t->prio > top->prio)){
+				top = t;
+			}
+		}
+		return top;
+	}
+
+	void OSMutex_init(OSMutex *me){
+		me->owner = (OSThread *)0;
+		me->heldNext = (OSMutex *)0;
+		OS_setClear(&me->waitingSet);
+		me->nest = 0U;
+	}
+
+	void OSMutex_lock(OSMutex *me){
+		uint32_t crit = OS_critEnter();
+
+		Q_REQUIRE((OS_curr != OS_thread[0]) && (OS_curr != OS_ceilingHolder));
+
+		if(me->owner == (OSThread *)0){
+			me->owner = OS_curr;								//Takes the free mutex
+			me->nest = 1U;
+			me->heldNext = OS_curr->heldMutex;
+			OS_curr->heldMutex = me;
+		}else if(me->owner == OS_curr){
+			me->nest++;											//Recursive lock by the owner
+			Q_ASSERT(me->nest != 0U);
+		}else{
+			OS_setInsert(&me->waitingSet, OS_curr->basePrio);	//Puts the current task in the waiting list of the mutex
+			OS_makeUnready(OS_curr);							//Puts the current task on hold
+			OS_curr->waitMutex = me;
+
+			/* lend the priority along the chain of owners blocked on other mutexes */
+			OSThread *t = me->owner;
+			while((t != (OSThread *)0) && (t->prio < OS_curr->prio)){
+				OS_prioMove(t, OS_curr->prio);
+				t = (t->waitMutex != (OSMutex *)0) ? t->waitMutex->owner : (OSThread *)0;
+			}
+
+			OS_sched();											//The ownership is handed over by OSMutex_unlock
+		}
+
+		OS_critExit(crit);
+	}
+
+	void OSMutex_unlock(OSMutex *me){
+		uint32_t crit = OS_critEnter();
+
+		Q_REQUIRE(me->owner == OS_curr);
+
+		me->nest--;
+		if(me->nest == 0U){
+			/* remove the mutex from the owner's list of held mutexes */
+			OSMutex **link = &OS_curr->heldMutex;
+			while(*link != me){
+				link = &(*link)->heldNext;
+			}
+			*link = me->heldNext;
+
+			/* drop the inherited priority down to what the remaining mutexes still need */
+			uint16_t prio = OS_curr->basePrio;
+			for(OSMutex *m = OS_curr->heldMutex; m != (OSMutex *)0; m = m->heldNext){
+				OSThread *w = OSMutex_topWaiter(m);
+				if((w != (OSThread *)0) && (w->prio > prio)){
+					prio = w->prio;
+				}
+			}
+			OS_prioMove(OS_curr, prio);
+
+			/* hand the mutex over to the highest-priority waiter */
+			OSThread *next = OSMutex_topWaiter(me);
+			if(next != (OSThread *)0){
+				OS_setRemove(&me->waitingSet, next->basePrio);
+				next->waitMutex = (OSMutex *)0;
+				me->owner = next;
+				me->nest = 1U;
+				me->heldNext = next->heldMutex;
+				next->heldMutex = me;
+
+				OSThread *w = OSMutex_topWaiter(me);
+				if((w != (OSThread *)0) && (w->prio > next->prio)){
+					next->prio = w->prio;						//Keeps lending to the new owner
+				}
+				OS_makeReady(next);
+			}else{
+				me->owner = (OSThread *)0;
+			}
+			OS_sched();
+		}
+
+		OS_critExit(crit);
+	}
+
+}//fim namespace
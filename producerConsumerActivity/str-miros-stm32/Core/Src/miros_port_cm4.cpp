@@ -0,0 +1,376 @@
+/****************************************************************************
+* MInimal Real-time Operating System (MiROS), GNU-ARM port.
+*
+* This software is a teaching aid to illustrate the concepts underlying
+* a Real-Time Operating System (RTOS). The main goal of the software is
+* simplicity and clear presentation of the concepts, but without dealing
+* with various corner cases, portability, or error handling. For these
+* reasons, the software is generally NOT intended or recommended for use
+* in commercial applications.
+*
+* Copyright (C) 2018 Miro Samek. All Rights Reserved.
+*
+* SPDX-License-Identifier: GPL-3.0-or-later
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <https://www.gnu.org/licenses/>.
+*
+* Git repo:
+* https://github.com/QuantumLeaps/MiROS
+****************************************************************************/
+#include <cstdint>
+#include <cstddef>
+#include "miros.h"
+#include "miros_port.h"
+#include "miros_trace.h"
+#include "qassert.h"
+
+Q_DEFINE_THIS_FILE
+
+/* Cortex-M4 port of the kernel: PendSV context switch on the main stack,
+* SysTick (optionally tickless) and the MPU stack guard
+*/
+
+#ifdef MIROS_MPU_GUARD
+/* the MPU region that guards the bottom of the running thread's stack */
+#define OS_MPU_GUARD_REGION 7U
+
+static_assert((offsetof(rtos::OSThread, mpuRbar) == 4U) && (offsetof(rtos::OSThread, mpuRasr) == 8U),
+	"PendSV_Handler loads the stack guard from fixed TCB offsets");
+#endif
+
+#ifdef MIROS_CCM
+/* the vector table copied to CCM: 16 exceptions and the IRQs up to FMAC,
+* aligned to the next power of two of its size as VTOR requires
+*/
+#define OS_CCM_VECTORS (16U + (uint32_t)FMAC_IRQn + 1U)
+
+static uint32_t OS_ccmVectors[OS_CCM_VECTORS] OS_CCM_DATA __attribute__((aligned(512)));
+#endif
+
+namespace rtos{
+	void OS_rtcExit(void);
+
+	static_assert(sizeof(OSPortFrame) == (17U * 4U), "PendSV_Handler switches 17-word contexts");
+
+	/* build the initial exception frame of a thread below the given stack top */
+	static uint32_t *OS_frameInit(uint32_t *sp, OSThreadHandler threadHandler, uint32_t lr) {
+		OSPortFrame *frame = (OSPortFrame *)sp - 1;
+		*frame = OS_portInitFrame(threadHandler, lr);
+		return (uint32_t *)frame;
+	}
+
+	void OS_portInit(void) {
+		/* set the PendSV interrupt priority to the lowest level 0xFF */
+		*(uint32_t volatile *)0xE000ED20 |= (0xFFU << 16);
+
+#if (__FPU_USED == 1U)
+		/* automatic and lazy FPU state preservation: the exception frame
+		* only reserves room for s0-s15, which are stored by the first FPU
+		* instruction in the handler (the VPUSH in PendSV_Handler)
+		*/
+		FPU->FPCCR |= FPU_FPCCR_ASPEN_Msk | FPU_FPCCR_LSPEN_Msk;
+#endif
+
+#ifdef MIROS_CCM
+		/* fetch the vectors from CCM too; the copy is identical, so an
+		* interrupt taken while VTOR moves is still served right
+		*/
+		uint32_t const *flashVectors = (uint32_t const *)SCB->VTOR;
+		for(uint32_t n = 0U; n < OS_CCM_VECTORS; n++){
+			OS_ccmVectors[n] = flashVectors[n];
+		}
+		SCB->VTOR = (uint32_t)OS_ccmVectors;
+		__DSB();
+#endif
+	}
+
+	void *OS_portFrame(uint32_t *bottom, uint32_t *top, OSThreadHandler threadHandler, bool rtc) {
+		(void)bottom;
+		return OS_frameInit(top, threadHandler, rtc ? (uint32_t)&OS_rtcExit : 0x0000000EU);
+	}
+
+	uint32_t *OS_portGuard(OSThread *me, uint32_t *bottom, uint32_t *top) {
+#ifdef MIROS_MPU_GUARD
+		/* the lowest 32-byte aligned block of the stack becomes a no-access
+		* region while the thread runs, so an overflow faults in MemManage
+		*/
+		uint32_t guard = ((((uint32_t)bottom + 31U) / 32U) * 32U);
+		Q_REQUIRE((uint32_t *)(guard + 32U) < top);
+		me->mpuRbar = ARM_MPU_RBAR(OS_MPU_GUARD_REGION, guard);
+		me->mpuRasr = ARM_MPU_RASR(1U, ARM_MPU_AP_NONE, 0U, 0U, 0U, 0U, 0U, ARM_MPU_REGION_SIZE_32B);
+		bottom = (uint32_t *)(guard + 32U);
+#else
+		(void)me;
+		(void)top;
+#endif
+		return bottom;
+	}
+
+	void OS_portRun(void) {
+#ifdef MIROS_MPU_GUARD
+		/* privileged code keeps the default memory map, except for the guard */
+		ARM_MPU_ClrRegion(OS_MPU_GUARD_REGION);
+		ARM_MPU_Enable(MPU_CTRL_PRIVDEFENA_Msk);
+#endif
+	}
+
+	/***********************************************/
+#ifdef MIROS_TICKLESS
+	/* fewest SysTick counts (at HCLK/8) left before a reload for the
+	* counter to be reprogrammed on the fly, which takes a few
+	*/
+#define OS_TICKLESS_GUARD 32U
+
+	static uint32_t OS_countsPerTick; /* SysTick counts in one tick */
+	static uint32_t OS_maxIdleTicks; /* longest idle period one SysTick reload can time */
+
+	/* make the next SysTick interrupt come 'counts' from now, then keep
+	* the regular period; writing VAL clears the counter, which loads
+	* LOAD at its next count and takes LOAD again only when it wraps
+	*/
+	static void OS_sysTickRestart(uint32_t counts) {
+		SysTick->LOAD = counts - 1U;
+		SysTick->VAL = 0U;
+		while(SysTick->VAL == 0U){ /* the load, within one count */
+		}
+		SysTick->LOAD = OS_countsPerTick - 1U;
+	}
+#endif
+
+	void OS_onStartup(void) {
+		SystemCoreClockUpdate();
+		SysTick_Config(SystemCoreClock / TICKS_PER_SEC);
+
+#ifdef MIROS_TICKLESS
+		/* clock SysTick from HCLK/8, so that a single 24-bit reload
+		* can span up to ~0.8 s of idle time instead of ~0.1 s at 170 MHz
+		*/
+		OS_countsPerTick = (SystemCoreClock / 8U) / TICKS_PER_SEC;
+		OS_maxIdleTicks = (SysTick_LOAD_RELOAD_Msk + 1U) / OS_countsPerTick;
+		SysTick->CTRL &= ~SysTick_CTRL_CLKSOURCE_Msk;
+		SysTick->LOAD = OS_countsPerTick - 1U;
+		SysTick->VAL = 0U;
+#endif
+
+		/* set the SysTick interrupt priority (the highest allowed to call
+		* the kernel, so OS_tick() needs no critical section of its own)
+		*/
+		NVIC_SetPriority(SysTick_IRQn, MIROS_SYSCALL_PRIO);
+
+#if defined(MIROS_PROFILE) || defined(MIROS_TRACE)
+		/* start the DWT cycle counter used for the kernel measurements;
+		* with MIROS_PROFILE it already counts from SystemInit() on
+		*/
+		CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+		DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+#ifdef MIROS_TRACE
+		OS_traceInit();
+#endif
+	}
+
+	void OS_onIdle(void) {
+#ifdef MIROS_TICKLESS
+		/* PRIMASK, not BASEPRI: WFI is woken only by interrupts that BASEPRI
+		* leaves unmasked, and the SysTick must wake it
+		*/
+		__disable_irq();
+
+		uint32_t ticks = OS_idleTicks();
+		if((ticks == 0U) || (ticks > OS_maxIdleTicks)){
+			ticks = OS_maxIdleTicks; /* no timeout, or too far for one reload */
+		}
+
+		/* the counter never stops: it is reprogrammed on the fly, and the
+		* counts it runs while that happens are taken off the new reload
+		*/
+		uint32_t now = SysTick->VAL;
+		if((ticks > 1U) && (now >= OS_TICKLESS_GUARD)
+			&& ((SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) == 0U)){
+			/* stretch the current tick up to the nearest timeout */
+			uint32_t const reload = now + ((ticks - 1U) * OS_countsPerTick);
+			OS_sysTickRestart(reload - (now - SysTick->VAL));
+
+			__DSB();
+			__WFI(); /* stop the CPU and Wait for Interrupt */
+			__ISB();
+
+			now = SysTick->VAL;
+			uint32_t elapsed = ticks - 1U;
+			if(((SysTick->CTRL & SysTick_CTRL_COUNTFLAG_Msk) == 0U) /* reading clears COUNTFLAG */
+				&& (now >= OS_TICKLESS_GUARD)){
+				/* another interrupt woke the CPU before the nearest timeout */
+				elapsed -= now / OS_countsPerTick;
+				uint32_t partial = now % OS_countsPerTick; /* counts to the next tick */
+				if(partial < OS_TICKLESS_GUARD){
+					/* too close to reprogram in time: that tick is taken now */
+					elapsed++;
+					partial += OS_countsPerTick;
+				}
+
+				/* finish the current tick, then go back to the regular period */
+				OS_sysTickRestart(partial - (now - SysTick->VAL));
+			}
+			/* else the whole period elapsed, or ends in a few counts: the
+			* regular period follows it, and the pending SysTick_Handler
+			* processes its last tick
+			*/
+
+			OS_tickAdvance(elapsed);
+			OS_sched();
+		}else{
+			/* the tick is due anyway: sleep until it, or any other interrupt */
+			__DSB();
+			__WFI(); /* stop the CPU and Wait for Interrupt */
+			__ISB();
+		}
+
+		__enable_irq();
+#elif defined(NDEBUG)
+		__WFI(); /* stop the CPU and Wait for Interrupt */
+#endif
+	}
+
+}//fim namespace
+
+void Q_onAssert(char const *module, int loc) {
+    /* TBD: damage control */
+    (void)module; /* avoid the "unused parameter" compiler warning */
+    (void)loc;    /* avoid the "unused parameter" compiler warning */
+    NVIC_SystemReset();
+}
+
+/***********************************************/
+/* return address of run-to-completion threads: leave the shared stack
+* for the system stack and let OS_rtcPark() switch to the next thread
+*/
+__attribute__ ((naked))
+void rtos::OS_rtcExit(void) {
+	__asm volatile(
+#if (MIROS_SYSCALL_PRIO == 0U)
+		"  CPSID         I                 \n"
+#else
+		"  MOV           r0,%0             \n"
+		"  MSR           basepri,r0        \n"
+		"  ISB                             \n"
+#endif
+		"  LDR           r0,=_estack       \n"
+		"  MOV           sp,r0             \n"
+		"  BL            _ZN4rtos10OS_rtcParkEv \n"
+#if (MIROS_SYSCALL_PRIO == 0U)
+		"  CPSIE         I                 \n"
+#else
+		"  MOV           r0,#0             \n"
+		"  MSR           basepri,r0        \n"
+#endif
+		"  B             .                 \n"
+		: : "i" (OS_CRIT_BASEPRI)
+		);
+}
+
+/***********************************************/
+OS_CCM_CODE __attribute__ ((naked, optimize("-fno-stack-protector")))
+void PendSV_Handler(void) {
+	__asm volatile(
+
+		/* rtos::OS_critEnter(); PendSV only runs with BASEPRI at 0 */
+#if (MIROS_SYSCALL_PRIO == 0U)
+		"  CPSID         I                 \n"
+#else
+		"  MOV           r0,%0             \n"
+		"  MSR           basepri,r0        \n"
+		"  ISB                             \n"
+#endif
+
+		/* if (OS_curr != (OSThread *)0) { */
+		"  LDR           r1,=_ZN4rtos7OS_currE       \n"
+		"  LDR           r1,[r1,#0x00]     \n"
+		"  CBZ           r1,PendSV_restore \n"
+
+#if (__FPU_USED == 1U)
+		/*     if the thread used the FPU (EXC_RETURN bit 4 clear),
+		*      push s16-s31; this also completes the lazy stacking of s0-s15
+		*/
+		"  TST           lr,#0x10          \n"
+		"  IT            EQ                \n"
+		"  VPUSHEQ       {s16-s31}         \n"
+#endif
+
+		/*     push registers r4-r11 and EXC_RETURN on the stack */
+		"  PUSH          {r4-r11,lr}       \n"
+
+		/*     OS_curr->sp = sp; */
+		"  LDR           r1,=_ZN4rtos7OS_currE       \n"
+		"  LDR           r1,[r1,#0x00]     \n"
+		"  STR           sp,[r1,#0x00]     \n"
+		/* } */
+
+		"PendSV_restore:                   \n"
+		/* OS_curr = OS_next; */
+		"  LDR           r1,=_ZN4rtos7OS_nextE       \n"
+		"  LDR           r1,[r1,#0x00]     \n"
+		"  LDR           r2,=_ZN4rtos7OS_currE       \n"
+		"  STR           r1,[r2,#0x00]     \n"
+
+#if defined(MIROS_PROFILE) || defined(MIROS_TRACE)
+		/* OS_switchHook(); still on the stack switched out, below its
+		*  saved context (OS_PORT_HOOK_STACK) and 8-byte aligned for the
+		*  call; clobbers r0-r3, r12 and lr, and r4, all reloaded below
+		*/
+		"  MOV           r4,sp             \n"
+		"  BIC           r4,r4,#7          \n"
+		"  MOV           sp,r4             \n"
+		"  BL            _ZN4rtos13OS_switchHookEv \n"
+#endif
+
+		/* sp = OS_next->sp; */
+		"  LDR           r1,=_ZN4rtos7OS_nextE       \n"
+		"  LDR           r1,[r1,#0x00]     \n"
+		"  LDR           sp,[r1,#0x00]     \n"
+
+#ifdef MIROS_MPU_GUARD
+		/* move the guard region to the bottom of the next thread's stack:
+		*  MPU->RBAR = OS_next->mpuRbar; MPU->RASR = OS_next->mpuRasr;
+		*/
+		"  LDR           r2,[r1,#0x04]     \n"
+		"  LDR           r3,[r1,#0x08]     \n"
+		"  LDR           r0,=0xE000ED9C    \n"
+		"  STMIA         r0,{r2,r3}        \n"
+		"  DSB                             \n"
+		"  ISB                             \n"
+#endif
+
+		/* pop registers r4-r11 and the EXC_RETURN of the next thread */
+		"  POP           {r4-r11,lr}       \n"
+
+#if (__FPU_USED == 1U)
+		/* restore s16-s31 if the next thread used the FPU */
+		"  TST           lr,#0x10          \n"
+		"  IT            EQ                \n"
+		"  VPOPEQ        {s16-s31}         \n"
+#endif
+
+		/* rtos::OS_critExit(0U); */
+#if (MIROS_SYSCALL_PRIO == 0U)
+		"  CPSIE         I                 \n"
+#else
+		"  MOV           r0,#0             \n"
+		"  MSR           basepri,r0        \n"
+#endif
+
+		/* return to the next thread, with its own frame type */
+		"  BX            lr                \n"
+		: : "i" (OS_CRIT_BASEPRI)
+		);
+}
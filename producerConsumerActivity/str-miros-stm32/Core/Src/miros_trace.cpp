@@ -0,0 +1,48 @@
+/*
+ * miros_trace.cpp
+ *
+ * Kernel event trace recorder, see miros_trace.h
+ */
+
+#include <cstdint>
+#include "miros.h"
+#include "miros_port.h"
+#include "miros_trace.h"
+
+#ifdef MIROS_TRACE
+
+namespace rtos {
+	OSTraceBuffer OS_trace;
+
+	extern OSThread * volatile OS_curr;
+
+	void OS_traceInit(void) {
+		OS_trace.cpuHz = OS_PORT_CYCLES_HZ();
+		OS_trace.size = MIROS_TRACE_SIZE;
+		OS_trace.head = 0U;
+		OS_trace.magic = OS_TRACE_MAGIC;
+
+		/* two records back to back: their distance is the cost of one record */
+		OS_traceRecord(OS_EVT_CALIB, 0U, 0U);
+		OS_traceRecord(OS_EVT_CALIB, 1U, 0U);
+	}
+
+	void OS_traceRecord(uint8_t event, uint8_t param, uint16_t id) {
+		uint32_t crit = OS_critEnter();
+
+		OSTraceRecord *r = &OS_trace.rec[OS_trace.head & (MIROS_TRACE_SIZE - 1U)];
+		r->timestamp = OS_PORT_CYCLES();
+		r->event = event;
+		r->param = param;
+		r->id = id;
+		OS_trace.head++;
+
+		OS_critExit(crit);
+	}
+
+	void OS_traceSwitch(void) {
+		OS_traceRecord(OS_EVT_SWITCH, 0U, OS_curr->basePrio);
+	}
+}
+
+#endif
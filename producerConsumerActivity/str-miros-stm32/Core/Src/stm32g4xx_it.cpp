@@ -23,6 +23,8 @@
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
 #include "miros.h"
+#include "miros_port.h"
+#include "miros_trace.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -181,17 +183,18 @@ void DebugMon_Handler(void)
 /**
   * @brief This function handles System tick timer.
   */
-void SysTick_Handler(void)
+OS_CCM_CODE void SysTick_Handler(void)
 {
   /* USER CODE BEGIN SysTick_IRQn 0 */
-
+  OS_TRACE_ISR_ENTER();
   /* USER CODE END SysTick_IRQn 0 */
   HAL_IncTick();
   /* USER CODE BEGIN SysTick_IRQn 1 */
   rtos::OS_tick();
-  __disable_irq();
+  uint32_t crit = rtos::OS_critEnter();
   rtos::OS_sched();
-  __enable_irq();
+  rtos::OS_critExit(crit);
+  OS_TRACE_ISR_EXIT();
   /* USER CODE END SysTick_IRQn 1 */
 }
 
@@ -47,6 +47,15 @@ defined in linker script */
 .word	_sbss
 /* end address for the .bss section. defined in linker script */
 .word	_ebss
+/* start address for the initialization values of the .ccmram section.
+defined in linker script */
+.word	_siccmram
+/* start and end address for the .ccmram section. defined in linker script */
+.word	_sccmram
+.word	_eccmram
+/* start and end address for the .ccmbss section. defined in linker script */
+.word	_sccmbss
+.word	_eccmbss
 
 .equ  BootRAM,        0xF1E0F85F
 /**
@@ -84,6 +93,23 @@ LoopCopyDataInit:
   adds r4, r0, r3
   cmp r4, r1
   bcc CopyDataInit
+
+/* Copy the CCM SRAM code (OS_CCM_CODE) from its load image */
+  ldr r0, =_sccmram
+  ldr r1, =_eccmram
+  ldr r2, =_siccmram
+  movs r3, #0
+  b	LoopCopyCcmInit
+
+CopyCcmInit:
+  ldr r4, [r2, r3]
+  str r4, [r0, r3]
+  adds r3, r3, #4
+
+LoopCopyCcmInit:
+  adds r4, r0, r3
+  cmp r4, r1
+  bcc CopyCcmInit
   
 /* Zero fill the bss segment. */
   ldr r2, =_sbss
@@ -99,6 +125,20 @@ LoopFillZerobss:
   cmp r2, r4
   bcc FillZerobss
 
+/* Zero fill the CCM SRAM bss segment (OS_CCM_DATA). */
+  ldr r2, =_sccmbss
+  ldr r4, =_eccmbss
+  movs r3, #0
+  b LoopFillZeroCcm
+
+FillZeroCcm:
+  str  r3, [r2]
+  adds r2, r2, #4
+
+LoopFillZeroCcm:
+  cmp r2, r4
+  bcc FillZeroCcm
+
 /* Call static constructors */
     bl __libc_init_array
 /* Call the application's entry point.*/
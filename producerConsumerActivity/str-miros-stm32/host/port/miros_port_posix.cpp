@@ -0,0 +1,217 @@
+/*
+ * miros_port_posix.cpp
+ *
+ * POSIX port of MiROS: ucontext threads, SIGALRM as the tick and the
+ * signal mask as PRIMASK, see miros_posix.h
+ */
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <csignal>
+#include <ctime>
+#include <sys/time.h>
+#include <ucontext.h>
+#include "miros.h"
+#include "miros_port.h"
+#include "miros_trace.h"
+#include "qassert.h"
+
+Q_DEFINE_THIS_FILE
+
+namespace rtos {
+	extern OSThread * volatile OS_curr;
+	extern OSThread * volatile OS_next;
+
+	static sigset_t OS_tickMask; /* just SIGALRM */
+	static uint32_t volatile OS_primask; /* 1 while SIGALRM is blocked by the kernel */
+	static bool volatile OS_isr; /* running the tick handler */
+	static bool volatile OS_switchPending; /* the PendSV of the port */
+
+	/* the run-to-completion threads leave their shared stack through here,
+	* like OS_rtcExit() moves to the system stack on the target
+	*/
+	static ucontext_t OS_parkCtx;
+	alignas(16) static uint8_t OS_parkStack[OS_PORT_STACK_MIN];
+
+	/* carry out the pending switch (SIGALRM blocked): save the context of
+	* OS_curr, unless the thread is gone, and resume OS_next
+	*/
+	static void OS_portSwitch(void) {
+		bool const isr = OS_isr;
+		while(OS_switchPending){
+			OS_switchPending = false;
+			OSThread *prev = OS_curr;
+			if(OS_next == prev){
+				continue;
+			}
+			OS_curr = OS_next;
+#if defined(MIROS_PROFILE) || defined(MIROS_TRACE)
+			OS_switchHook();
+#endif
+			if(prev == (OSThread *)0){
+				(void)setcontext((ucontext_t *)OS_curr->sp);
+				Q_ERROR(); /* setcontext() does not return */
+			}
+			(void)swapcontext((ucontext_t *)prev->sp, (ucontext_t *)OS_curr->sp);
+
+			/* switched back in, where the thread was switched out */
+			OS_isr = isr;
+			OS_primask = 1U;
+		}
+	}
+
+	void OS_portDisable(void) {
+		if(!OS_isr){ /* the tick handler runs with SIGALRM blocked anyway */
+			(void)sigprocmask(SIG_BLOCK, &OS_tickMask, (sigset_t *)0);
+		}
+		OS_primask = 1U;
+	}
+
+	void OS_portEnable(void) {
+		if(OS_isr){
+			OS_primask = 0U; /* the switch waits for the end of the handler */
+			return;
+		}
+		OS_portSwitch();
+		OS_primask = 0U;
+		(void)sigprocmask(SIG_UNBLOCK, &OS_tickMask, (sigset_t *)0);
+	}
+
+	uint32_t OS_portPrimask(void) {
+		return OS_primask;
+	}
+
+	uint32_t OS_portIpsr(void) {
+		return OS_isr ? 15U : 0U;
+	}
+
+	void OS_portPend(void) {
+		OS_switchPending = true;
+	}
+
+	uint32_t OS_portCycles(void) {
+		struct timespec now;
+		(void)clock_gettime(CLOCK_MONOTONIC, &now);
+		return (uint32_t)(((uint64_t)now.tv_sec * 1000000000U) + (uint64_t)now.tv_nsec);
+	}
+
+	/* the SysTick_Handler of the port */
+	static void OS_portTick(int sig) {
+		(void)sig;
+		int const savedErrno = errno;
+
+		OS_isr = true;
+		OS_TRACE_ISR_ENTER();
+		OS_tick();
+		uint32_t crit = OS_critEnter();
+		OS_sched();
+		OS_critExit(crit);
+		OS_TRACE_ISR_EXIT();
+
+		/* PendSV tail-chains to the tick */
+		OS_primask = 1U;
+		OS_portSwitch();
+		OS_isr = false;
+		OS_primask = 0U;
+
+		errno = savedErrno;
+	}
+
+	/* first code of every thread, entered from OS_portSwitch() */
+	static void OS_portEnter(void) {
+		OS_isr = false;
+		__enable_irq();
+	}
+
+	static void OS_portEntry(void) {
+		OS_portEnter();
+		OS_curr->handler();
+
+		/* a regular thread must never return */
+		Q_ERROR();
+	}
+
+	static void OS_portPark(void) {
+		OS_rtcPark();
+		OS_portSwitch(); /* OS_curr is 0, so this never returns */
+		Q_ERROR();
+	}
+
+	static void OS_portRtcEntry(void) {
+		OS_portEnter();
+		OS_curr->handler();
+
+		/* the context on the shared stack is dead from here on */
+		__disable_irq();
+		(void)getcontext(&OS_parkCtx);
+		OS_parkCtx.uc_stack.ss_sp = OS_parkStack;
+		OS_parkCtx.uc_stack.ss_size = sizeof(OS_parkStack);
+		OS_parkCtx.uc_link = (ucontext_t *)0;
+		OS_parkCtx.uc_sigmask = OS_tickMask;
+		makecontext(&OS_parkCtx, &OS_portPark, 0);
+		(void)setcontext(&OS_parkCtx);
+		Q_ERROR();
+	}
+
+	void OS_portInit(void) {
+		(void)sigemptyset(&OS_tickMask);
+		(void)sigaddset(&OS_tickMask, SIGALRM);
+	}
+
+	void *OS_portFrame(uint32_t *bottom, uint32_t *top, OSThreadHandler threadHandler, bool rtc) {
+		/* the context is kept at the top of the stack, the thread runs below it */
+		(void)threadHandler; /* called through OS_curr->handler */
+		ucontext_t *ctx = (ucontext_t *)((((uintptr_t)top - sizeof(ucontext_t)) / 16U) * 16U);
+		Q_REQUIRE((uintptr_t)ctx >= (uintptr_t)bottom + OS_PORT_STACK_MIN);
+
+		(void)getcontext(ctx);
+		ctx->uc_stack.ss_sp = bottom;
+		ctx->uc_stack.ss_size = (size_t)((uintptr_t)ctx - (uintptr_t)bottom);
+		ctx->uc_link = (ucontext_t *)0;
+		ctx->uc_sigmask = OS_tickMask; /* switched in with the tick blocked */
+		makecontext(ctx, rtc ? &OS_portRtcEntry : &OS_portEntry, 0);
+		return ctx;
+	}
+
+	uint32_t *OS_portGuard(OSThread *me, uint32_t *bottom, uint32_t *top) {
+		(void)me;
+		(void)top;
+		return bottom; /* no stack guard, overflows show in OSThread_stackHighWater() */
+	}
+
+	void OS_portRun(void) {
+	}
+
+	void OS_onStartup(void) {
+		struct sigaction sa;
+		sa.sa_handler = &OS_portTick;
+		sa.sa_mask = OS_tickMask;
+		sa.sa_flags = SA_RESTART;
+		(void)sigaction(SIGALRM, &sa, (struct sigaction *)0);
+
+		struct itimerval period;
+		period.it_interval.tv_sec = 0;
+		period.it_interval.tv_usec = 1000000 / TICKS_PER_SEC;
+		period.it_value = period.it_interval;
+		(void)setitimer(ITIMER_REAL, &period, (struct itimerval *)0);
+
+#ifdef MIROS_TRACE
+		OS_traceInit();
+#endif
+	}
+
+	void OS_onIdle(void) {
+		/* sleep until the next signal, the WFI of the port */
+		sigset_t none;
+		(void)sigemptyset(&none);
+		(void)sigsuspend(&none);
+	}
+
+}//fim namespace
+
+void Q_onAssert(char const *module, int loc) {
+	fprintf(stderr, "assertion failed in %s:%d\n", module, loc);
+	abort();
+}
@@ -0,0 +1,103 @@
+/*
+ * miros_posix.h
+ *
+ * POSIX port of MiROS, included by miros_port.h with -DMIROS_PORT_POSIX.
+ *
+ * The whole kernel runs in one Linux thread. Each MiROS thread is a
+ * ucontext on its own stack, and SIGALRM from an interval timer is the
+ * SysTick: "interrupts disabled" means SIGALRM blocked. As with PendSV, a
+ * switch requested by OS_sched() happens once the signal is unblocked, or
+ * at the end of the tick handler when it preempts a thread.
+ *
+ * NOTE: preemption can hit a thread inside the C library; threads that
+ * call non-reentrant functions (malloc, stdio) must not run concurrently
+ * or must call them with interrupts disabled.
+ */
+
+#ifndef MIROS_POSIX_H_
+#define MIROS_POSIX_H_
+
+#include <cstdint>
+
+#ifdef MIROS_TICKLESS
+#error "MIROS_TICKLESS is not supported by the POSIX port"
+#endif
+#ifdef MIROS_MPU_GUARD
+#error "MIROS_MPU_GUARD is not supported by the POSIX port"
+#endif
+#ifdef MIROS_CCM
+#error "MIROS_CCM is not supported by the POSIX port"
+#endif
+
+namespace rtos {
+	/* smallest thread stack in bytes: it holds the saved context, the
+	* signal frame of the tick and whatever the C library needs
+	*/
+	const uint32_t OS_PORT_STACK_MIN = 16384U;
+
+	void OS_portDisable(void);
+	void OS_portEnable(void);
+	uint32_t OS_portPrimask(void);
+	uint32_t OS_portIpsr(void);
+
+	/* request the switch to OS_next (must be called with interrupts DISABLED) */
+	void OS_portPend(void);
+
+	/* CLOCK_MONOTONIC in ns, the "cycles" of the kernel measurements */
+	uint32_t OS_portCycles(void);
+
+	/* the kernel critical section blocks the tick, the only interrupt */
+	static inline uint32_t OS_critEnter(void) {
+		uint32_t primask = OS_portPrimask();
+		OS_portDisable();
+		return primask;
+	}
+
+	static inline void OS_critExit(uint32_t mask) {
+		if(mask == 0U){
+			OS_portEnable();
+		}
+	}
+}
+
+/* the CMSIS intrinsics used by the kernel and the applications */
+static inline void __disable_irq(void) {
+	rtos::OS_portDisable();
+}
+
+static inline void __enable_irq(void) {
+	rtos::OS_portEnable();
+}
+
+static inline uint32_t __get_PRIMASK(void) {
+	return rtos::OS_portPrimask();
+}
+
+static inline void __set_PRIMASK(uint32_t primask) {
+	if(primask != 0U){
+		rtos::OS_portDisable();
+	}else{
+		rtos::OS_portEnable();
+	}
+}
+
+/* 15 (SysTick) inside the tick handler, 0 in thread mode */
+static inline uint32_t __get_IPSR(void) {
+	return rtos::OS_portIpsr();
+}
+
+static inline uint32_t __CLZ(uint32_t x) {
+	return (x != 0U) ? (uint32_t)__builtin_clz(x) : 32U;
+}
+
+#define __COMPILER_BARRIER() __asm volatile ("" ::: "memory")
+
+/* no CCM SRAM on the host */
+#define OS_CCM_CODE
+#define OS_CCM_DATA
+#define OS_CCM_INIT
+
+#define OS_PORT_CYCLES() (rtos::OS_portCycles())
+#define OS_PORT_CYCLES_HZ() (1000000000U)
+
+#endif /* MIROS_POSIX_H_ */
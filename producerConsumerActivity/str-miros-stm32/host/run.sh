@@ -0,0 +1,13 @@
+echo "Compilando código..."
+rm -rf build/*
+mkdir -p build
+cd build
+cmake .. "$@"
+make -j$(nproc)
+./producerConsumer
+
+# Com as medições do kernel (tempos em ns no lugar de ciclos):
+# ./run.sh -DMIROS_PROFILE=ON
+
+# Testes do kernel no host (test/), depois de compilar:
+# (cd build && ctest --output-on-failure)
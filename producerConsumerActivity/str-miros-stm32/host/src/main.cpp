@@ -0,0 +1,116 @@
+/*
+ * main.cpp
+ *
+ * The producer/consumer application of the firmware (Core/Src/main.cpp)
+ * running on the POSIX port: same threads, priorities and kernel calls,
+ * with a monitor thread that reports once per second and exits.
+ *
+ * usage: producerConsumer [seconds]
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include "miros.h"
+#include "miros_port.h"
+#include "spsc_ring.h"
+
+/* stacks must hold at least OS_PORT_STACK_MIN bytes on the host */
+#define STACK_WORDS (rtos::OS_PORT_STACK_MIN / 2U)
+
+rtos::SpscRing<uint32_t, 16U> buffer;
+
+/* periods that started late, because the previous one overran */
+uint32_t volatile prodOverruns;
+uint32_t volatile consOverruns;
+
+uint32_t volatile produced;
+uint32_t volatile consumed;
+uint32_t volatile lastCode;
+
+uint32_t stackProd[STACK_WORDS];
+rtos::OSThread prod;
+void producer(){
+	uint32_t code = 1;
+	uint64_t lastWake = rtos::OS_getTicks();
+
+	while(1){
+		buffer.push(code);
+		produced++;
+
+		code++;
+		if(!rtos::OS_delayUntil(&lastWake, rtos::TICKS_PER_SEC / 10U)){
+			prodOverruns++;
+		}
+	}
+}
+
+uint32_t stackCons[STACK_WORDS];
+rtos::OSThread cons;
+void consumer(){
+	uint64_t lastWake = rtos::OS_getTicks();
+
+	while(1){
+		lastCode = buffer.pop();
+		consumed++;
+
+		if(!rtos::OS_delayUntil(&lastWake, rtos::TICKS_PER_SEC / 10U)){
+			consOverruns++;
+		}
+	}
+}
+
+/* the only thread using stdio, see miros_posix.h */
+uint32_t runSeconds = 5U;
+uint32_t stackMonitor[STACK_WORDS];
+rtos::OSThread monitor;
+void monitorThread(){
+	uint64_t lastWake = rtos::OS_getTicks();
+
+	for(uint32_t s = 1U; s <= runSeconds; s++){
+		rtos::OS_delayUntil(&lastWake, rtos::TICKS_PER_SEC);
+		printf("%3lu s  ticks %6llu  produced %4lu  consumed %4lu  last %4lu  overruns %lu/%lu\n",
+			(unsigned long)s, (unsigned long long)rtos::OS_getTicks(), (unsigned long)produced,
+			(unsigned long)consumed, (unsigned long)lastCode, (unsigned long)prodOverruns, (unsigned long)consOverruns);
+	}
+
+#ifdef MIROS_PROFILE
+	rtos::OSThreadStats stats[4];
+	uint16_t n = rtos::OS_getStats(stats, 4U);
+	printf("\nprio  switches  max resp [ns]  runtime [ms]     CPU\n");
+	for(uint16_t i = 0U; i < n; i++){
+		printf("%4u  %8lu  %13lu  %12lu  %3u.%02u%%\n", stats[i].thread->basePrio,
+			(unsigned long)stats[i].switches, (unsigned long)stats[i].maxResponse,
+			(unsigned long)(stats[i].runCycles / (OS_PORT_CYCLES_HZ() / 1000U)), stats[i].cpu / 100U, stats[i].cpu % 100U);
+	}
+	printf("OS_sched max %lu ns, OS_tick max %lu ns\n",
+		(unsigned long)rtos::OS_schedMaxCycles, (unsigned long)rtos::OS_tickMaxCycles);
+#endif
+
+	/* a consumer that kept up saw every code in order */
+	int const ok = (consumed != 0U) && (lastCode == consumed);
+	__disable_irq();
+	exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+uint32_t stack_idleThread[STACK_WORDS];
+
+int main(int argc, char *argv[]){
+	if(argc > 1){
+		runSeconds = (uint32_t)atoi(argv[1]);
+	}
+
+	rtos::OS_init(stack_idleThread, sizeof(stack_idleThread));
+
+	/* start the producer thread */
+	rtos::OSThread_start(&prod, 2U, &producer, stackProd, sizeof(stackProd));
+
+	/* start the consumer thread */
+	rtos::OSThread_start(&cons, 1U, &consumer, stackCons, sizeof(stackCons));
+
+	/* start the monitor */
+	rtos::OSThread_start(&monitor, 3U, &monitorThread, stackMonitor, sizeof(stackMonitor));
+
+	/* transfer control to the RTOS to run the threads */
+	rtos::OS_run();
+}
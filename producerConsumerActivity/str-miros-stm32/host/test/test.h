@@ -0,0 +1,53 @@
+/*
+ * test.h
+ *
+ * Checks of the host tests. Each test is one program: main() starts the
+ * threads and calls OS_run(), the checks run in the threads, and a
+ * monitor ends the program with TEST_PASS(), so ctest sees the verdict
+ * in the exit status.
+ */
+
+#ifndef TEST_H_
+#define TEST_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include "miros.h"
+#include "miros_port.h"
+
+/* stacks must hold at least OS_PORT_STACK_MIN bytes on the host */
+#define TEST_STACK_WORDS (rtos::OS_PORT_STACK_MIN / 2U)
+
+/* report the first failed check and end the program */
+#define TEST_CHECK(cond_) \
+	((cond_) ? (void)0 : test_fail(__FILE__, __LINE__, #cond_))
+
+static inline void test_fail(char const *file, int line, char const *cond) {
+	__disable_irq(); /* no preemption inside stdio, see miros_posix.h */
+	fprintf(stderr, "%s:%d: check failed: %s\n", file, line, cond);
+	exit(EXIT_FAILURE);
+}
+
+#define TEST_PASS() \
+	do { \
+		__disable_irq(); \
+		printf("passed\n"); \
+		exit(EXIT_SUCCESS); \
+	} while(0)
+
+/* run for about ticks ticks of the caller's own CPU time: a tick counts
+* when the caller sees it go by, so a preemption of any length costs one
+*/
+static inline void test_burn(uint32_t ticks) {
+	uint64_t seen = rtos::OS_getTicks();
+	while(ticks != 0U){
+		uint64_t const now = rtos::OS_getTicks();
+		if(now != seen){
+			seen = now;
+			ticks--;
+		}
+	}
+}
+
+#endif /* TEST_H_ */
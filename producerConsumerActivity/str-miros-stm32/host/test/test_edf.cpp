@@ -0,0 +1,108 @@
+/*
+ * test_edf.cpp
+ *
+ * The EDF band (-DMIROS_EDF): three periodic threads at priorities 1..3
+ * whose deadlines run against their priorities. Their first jobs start in
+ * deadline order; while any job runs, no other released job of the band
+ * has an earlier deadline, as the heap reorders on every release and every
+ * OS_edfNextPeriod(); and one job made to overrun is the only one reported
+ * as a miss.
+ */
+
+#include "test.h"
+
+using namespace rtos;
+
+#define N_TASKS 3U
+#define OVERRUN_JOB 4U /* job of task 0 that runs past its deadline */
+
+/* period, deadline and work in ticks, the earliest deadline at the lowest priority */
+static uint32_t const period[N_TASKS] = { 10U, 20U, 40U };
+static uint32_t const deadline[N_TASKS] = { 10U, 20U, 40U };
+static uint32_t const work[N_TASKS] = { 2U, 4U, 6U };
+
+OSThread tasks[N_TASKS];
+uint32_t volatile jobs[N_TASKS];
+uint32_t volatile misses[N_TASKS];
+uint16_t starts[8]; /* priorities of the first jobs to start */
+uint32_t volatile nStarts;
+
+/* the running job has the earliest deadline of the released jobs */
+static void checkEarliest(OSThread const *me) {
+	uint32_t crit = OS_critEnter();
+	for(uint32_t i = 0U; i < N_TASKS; i++){
+		OSThread const *t = &tasks[i];
+		if((t != me) && (t->release <= OS_getTicks())){
+			TEST_CHECK(t->absDeadline >= me->absDeadline);
+		}
+	}
+	OS_critExit(crit);
+}
+
+/* test_burn() that checks the order at every step */
+static void burn(OSThread const *me, uint32_t ticks) {
+	uint64_t seen = OS_getTicks();
+	while(ticks != 0U){
+		checkEarliest(me);
+		uint64_t const now = OS_getTicks();
+		if(now != seen){
+			seen = now;
+			ticks--;
+		}
+	}
+}
+
+template <uint32_t i>
+void task(){
+	OSThread const *me = &tasks[i];
+	while(1){
+		uint32_t crit = OS_critEnter();
+		if(nStarts < (sizeof(starts) / sizeof(starts[0]))){
+			starts[nStarts] = me->basePrio;
+			nStarts = nStarts + 1U;
+		}
+		OS_critExit(crit);
+
+		bool const overrun = (i == 0U) && (jobs[i] == OVERRUN_JOB);
+		burn(me, overrun ? (deadline[i] + 1U) : work[i]);
+		jobs[i]++;
+		if(!OS_edfNextPeriod()){
+			TEST_CHECK(overrun);
+			misses[i]++;
+		}
+	}
+}
+
+uint32_t stackMonitor[TEST_STACK_WORDS];
+OSThread monitor;
+void monitorThread(){
+	OS_delay(120U);
+
+	/* deadline order, the reverse of the priorities */
+	TEST_CHECK(nStarts >= 3U);
+	TEST_CHECK((starts[0] == 1U) && (starts[1] == 2U) && (starts[2] == 3U));
+
+	TEST_CHECK(misses[0] == 1U);
+	TEST_CHECK((misses[1] == 0U) && (misses[2] == 0U));
+	for(uint32_t i = 0U; i < N_TASKS; i++){
+		TEST_CHECK(jobs[i] >= (120U / period[i]) - 1U);
+	}
+	TEST_PASS();
+}
+
+uint32_t stacks[N_TASKS][TEST_STACK_WORDS];
+uint32_t stack_idleThread[TEST_STACK_WORDS];
+
+int main(){
+	static OSThreadHandler const bodies[N_TASKS] = { &task<0U>, &task<1U>, &task<2U> };
+
+	OS_init(stack_idleThread, sizeof(stack_idleThread));
+	OS_edfInit(1U, N_TASKS);
+	for(uint32_t i = 0U; i < N_TASKS; i++){
+		OSThread_start(&tasks[i], (uint16_t)(i + 1U), bodies[i], stacks[i], sizeof(stacks[i]));
+		OSThread_setEdf(&tasks[i], period[i], deadline[i]);
+	}
+	OSThread_start(&monitor, 9U, &monitorThread, stackMonitor, sizeof(stackMonitor));
+
+	OS_run();
+}
@@ -0,0 +1,131 @@
+/*
+ * test_inversion.cpp
+ *
+ * The L/M/H priority inversion: L holds the lock when H asks for it, and M,
+ * in between, becomes ready. Locked with a semaphore, M preempts L and H
+ * waits for all of M's work; locked with an OSMutex, L runs at H's priority
+ * until it unlocks, so H waits only for L's critical section.
+ */
+
+#include "test.h"
+
+using namespace rtos;
+
+/* CPU time in ticks of L's critical section and of M's work */
+#define LOW_TICKS 2U
+#define MID_TICKS 20U
+#define ROUNDS 3U
+
+OSSem semLock;
+OSMutex mutexLock;
+OSSem goLow;
+OSSem goHigh;
+OSSem goMid;
+OSSem roundDone;
+
+bool volatile useMutex;
+uint64_t volatile blocked; /* ticks H waited for the lock */
+
+static void lock(void) {
+	if(useMutex){
+		OSMutex_lock(&mutexLock);
+	}else{
+		(void)OSSem_pend(&semLock, OS_WAIT_FOREVER);
+	}
+}
+
+static void unlock(void) {
+	if(useMutex){
+		OSMutex_unlock(&mutexLock);
+	}else{
+		OSSem_post(&semLock);
+	}
+}
+
+uint32_t stackLow[TEST_STACK_WORDS];
+OSThread threadLow;
+void low(){
+	while(1){
+		(void)OSSem_pend(&goLow, OS_WAIT_FOREVER);
+		lock();
+		OSSem_post(&goHigh); /* H preempts and blocks on the lock */
+		OSSem_post(&goMid); /* without inheritance M preempts here */
+		test_burn(LOW_TICKS);
+		unlock();
+	}
+}
+
+uint32_t stackMid[TEST_STACK_WORDS];
+OSThread threadMid;
+void mid(){
+	while(1){
+		(void)OSSem_pend(&goMid, OS_WAIT_FOREVER);
+		test_burn(MID_TICKS);
+	}
+}
+
+uint32_t stackHigh[TEST_STACK_WORDS];
+OSThread threadHigh;
+void high(){
+	while(1){
+		(void)OSSem_pend(&goHigh, OS_WAIT_FOREVER);
+		uint64_t const start = OS_getTicks();
+		lock();
+		blocked = OS_getTicks() - start;
+		unlock();
+		OSSem_post(&roundDone);
+	}
+}
+
+/* worst blocking of H over the rounds; the next round starts once M is
+* done, since L is below it
+*/
+static uint64_t worstBlocking(bool withMutex) {
+	uint64_t worst = 0U;
+	useMutex = withMutex;
+	for(uint32_t r = 0U; r < ROUNDS; r++){
+		OSSem_post(&goLow);
+		(void)OSSem_pend(&roundDone, OS_WAIT_FOREVER);
+		if(blocked > worst){
+			worst = blocked;
+		}
+	}
+	return worst;
+}
+
+uint32_t stackMonitor[TEST_STACK_WORDS];
+OSThread monitor;
+void monitorThread(){
+	uint64_t const withSem = worstBlocking(false);
+	uint64_t const withMutex = worstBlocking(true);
+
+	__disable_irq();
+	printf("H blocked: semaphore %llu ticks, mutex %llu ticks (L %u, M %u)\n",
+		(unsigned long long)withSem, (unsigned long long)withMutex, LOW_TICKS, MID_TICKS);
+	__enable_irq();
+
+	/* unbounded: L's critical section stretched by all of M */
+	TEST_CHECK(withSem >= LOW_TICKS + MID_TICKS - 1U);
+	/* bounded by L's critical section, give or take a tick */
+	TEST_CHECK(withMutex <= LOW_TICKS + 1U);
+	TEST_PASS();
+}
+
+uint32_t stack_idleThread[TEST_STACK_WORDS];
+
+int main(){
+	OS_init(stack_idleThread, sizeof(stack_idleThread));
+	OSSem_init(&semLock, 1U);
+	OSMutex_init(&mutexLock);
+	OSSem_init(&goLow, 0U);
+	OSSem_init(&goHigh, 0U);
+	OSSem_init(&goMid, 0U);
+	OSSem_init(&roundDone, 0U);
+
+	OSThread_start(&threadLow, 1U, &low, stackLow, sizeof(stackLow));
+	OSThread_start(&threadMid, 2U, &mid, stackMid, sizeof(stackMid));
+	OSThread_start(&threadHigh, 3U, &high, stackHigh, sizeof(stackHigh));
+	OSThread_start(&monitor, 4U, &monitorThread, stackMonitor, sizeof(stackMonitor));
+
+	OS_run();
+}
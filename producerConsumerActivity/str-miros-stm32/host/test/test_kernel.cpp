@@ -0,0 +1,178 @@
+/*
+ * test_kernel.cpp
+ *
+ * The kernel services together under tick preemption: two CPU-bound
+ * threads sharing a mutex, run-to-completion threads on a shared stack
+ * activated from a timer callback, event flags set by the same timer and
+ * messages through an OSQueue, checked by a monitor at the top priority.
+ */
+
+#include "test.h"
+
+using namespace rtos;
+
+OSMutex mtx;
+OSTimer timer;
+OSEventFlags ev;
+OSSharedStack shared;
+OSQueue queue;
+void *queueSto[4];
+uint32_t msgs[8];
+
+OSThread * volatile mtxOwner; /* thread inside the mutex */
+uint64_t volatile spinLow;
+uint64_t volatile spinHigh;
+uint32_t volatile critRuns;
+uint32_t volatile rtcRuns1;
+uint32_t volatile rtcRuns2;
+uint32_t volatile timerFires;
+uint32_t volatile evHits;
+uint32_t volatile evTimeouts;
+uint32_t volatile received;
+
+extern OSThread threadLow, threadHigh;
+
+/* mutual exclusion holds across preemptions and delays */
+static void criticalSection(OSThread *me, bool delay) {
+	OSMutex_lock(&mtx);
+	TEST_CHECK(mtxOwner == (OSThread *)0);
+	mtxOwner = me;
+	critRuns++;
+	if(delay){
+		OS_delay(1U);
+	}
+	TEST_CHECK(mtxOwner == me);
+	mtxOwner = (OSThread *)0;
+	OSMutex_unlock(&mtx);
+}
+
+uint32_t stackLow[TEST_STACK_WORDS];
+OSThread threadLow;
+void low(){
+	while(1){
+		spinLow++;
+		if((spinLow & 0xFFFFFU) == 0U){
+			criticalSection(&threadLow, false);
+		}
+	}
+}
+
+uint32_t stackHigh[TEST_STACK_WORDS];
+OSThread threadHigh;
+void high(){
+	while(1){
+		spinHigh++;
+		if((spinHigh & 0x3FFFFU) == 0U){
+			criticalSection(&threadHigh, true);
+		}
+	}
+}
+
+/* the run-to-completion threads, on one stack */
+OSThread rtc1;
+void rtcBody1(){
+	rtcRuns1++;
+}
+
+OSThread rtc2;
+void rtcBody2(){
+	rtcRuns2++;
+	OSThread_activate(&rtc1);
+}
+
+void onTimer(void *arg){
+	(void)arg;
+	timerFires++;
+	OSThread_activate(&rtc2);
+	OSEventFlags_set(&ev, 1U);
+}
+
+uint32_t stackWaiter[TEST_STACK_WORDS];
+OSThread waiter;
+void waiterThread(){
+	while(1){
+		uint32_t matched = 0U;
+		if(OSEventFlags_wait(&ev, 1U, OS_FLAGS_CLEAR, 50U, &matched) == OS_OK){
+			TEST_CHECK(matched == 1U);
+			evHits++;
+		}else{
+			evTimeouts++;
+		}
+	}
+}
+
+uint32_t stackSender[TEST_STACK_WORDS];
+OSThread sender;
+void senderThread(){
+	for(uint32_t n = 0U; ; n++){
+		msgs[n % 8U] = n;
+		(void)OSQueue_post(&queue, &msgs[n % 8U], OS_WAIT_FOREVER);
+		if((n % 4U) == 3U){
+			OS_delay(1U);
+		}
+	}
+}
+
+/* messages come out in order, and before the sender reuses their slot */
+uint32_t stackReceiver[TEST_STACK_WORDS];
+OSThread receiver;
+void receiverThread(){
+	while(1){
+		void *msg;
+		TEST_CHECK(OSQueue_get(&queue, &msg, OS_WAIT_FOREVER) == OS_OK);
+		TEST_CHECK(*(uint32_t *)msg == received);
+		received++;
+	}
+}
+
+uint32_t stackMonitor[TEST_STACK_WORDS];
+OSThread monitor;
+void monitorThread(){
+	uint64_t lastWake = OS_getTicks();
+
+	for(uint32_t s = 0U; s < 3U; s++){
+		OS_delayUntil(&lastWake, TICKS_PER_SEC);
+		TEST_CHECK(OS_getTicks() == lastWake);
+	}
+
+	/* the monitor preempts at a tick, where every callback has run */
+	TEST_CHECK((spinLow != 0U) && (spinHigh != 0U));
+	TEST_CHECK(critRuns != 0U);
+	TEST_CHECK(timerFires >= (3U * TICKS_PER_SEC / 3U) - 1U);
+	TEST_CHECK(rtcRuns2 == timerFires);
+	TEST_CHECK(rtcRuns1 == rtcRuns2);
+	TEST_CHECK(evHits != 0U);
+	TEST_CHECK(evTimeouts == 0U);
+	TEST_CHECK(received != 0U);
+	TEST_PASS();
+}
+
+uint32_t stackTimer[TEST_STACK_WORDS];
+uint32_t stackShared[TEST_STACK_WORDS];
+uint32_t stack_idleThread[TEST_STACK_WORDS];
+
+int main(){
+	OS_init(stack_idleThread, sizeof(stack_idleThread));
+	OSMutex_init(&mtx);
+	OSEventFlags_init(&ev, 0U);
+	OSQueue_init(&queue, queueSto, 4U);
+
+	OSThread_start(&threadLow, 1U, &low, stackLow, sizeof(stackLow));
+	OSThread_start(&threadHigh, 2U, &high, stackHigh, sizeof(stackHigh));
+
+	OSSharedStack_init(&shared, stackShared, sizeof(stackShared));
+	OSThread_startRtc(&rtc1, 3U, &rtcBody1, &shared);
+	OSThread_startRtc(&rtc2, 4U, &rtcBody2, &shared);
+
+	OSThread_start(&waiter, 5U, &waiterThread, stackWaiter, sizeof(stackWaiter));
+	OSThread_start(&sender, 6U, &senderThread, stackSender, sizeof(stackSender));
+	OSThread_start(&receiver, 7U, &receiverThread, stackReceiver, sizeof(stackReceiver));
+
+	OS_timerInit(8U, stackTimer, sizeof(stackTimer));
+	OSTimer_init(&timer, &onTimer, (void *)0);
+	OSTimer_start(&timer, 3U, 3U);
+
+	OSThread_start(&monitor, 9U, &monitorThread, stackMonitor, sizeof(stackMonitor));
+
+	OS_run();
+}
@@ -0,0 +1,97 @@
+/*
+ * test_threshold.cpp
+ *
+ * Preemption threshold: a CPU-bound thread at priority 2 with threshold 4
+ * keeps a ready thread at 3 waiting, is still preempted by a thread at 5,
+ * and lets the one at 3 in as soon as it lowers its threshold.
+ */
+
+#include "test.h"
+
+using namespace rtos;
+
+OSSem goMid;
+OSSem goHigh;
+OSSem never;
+
+uint32_t volatile progress; /* work of the threshold thread */
+bool volatile lowerNow;
+bool volatile lowered;
+bool volatile midRan;
+uint32_t volatile highRuns;
+
+uint32_t stackWorker[TEST_STACK_WORDS];
+OSThread worker;
+void workerThread(){
+	while(1){
+		progress++;
+		if(lowerNow && !lowered){
+			lowered = true;
+			OSThread_setThreshold(&worker, worker.basePrio);
+			/* the waiting thread preempted inside the call */
+			TEST_CHECK(midRan);
+		}
+	}
+}
+
+uint32_t stackMid[TEST_STACK_WORDS];
+OSThread mid;
+void midThread(){
+	(void)OSSem_pend(&goMid, OS_WAIT_FOREVER);
+	TEST_CHECK(lowered);
+	midRan = true;
+	(void)OSSem_pend(&never, OS_WAIT_FOREVER);
+}
+
+uint32_t stackHigh[TEST_STACK_WORDS];
+OSThread high;
+void highThread(){
+	while(1){
+		(void)OSSem_pend(&goHigh, OS_WAIT_FOREVER);
+		TEST_CHECK(!lowered);
+		highRuns++;
+	}
+}
+
+uint32_t stackMonitor[TEST_STACK_WORDS];
+OSThread monitor;
+void monitorThread(){
+	OS_delay(1U); /* the worker is switched in, with its threshold */
+
+	/* below the threshold: mid waits while the worker runs */
+	OSSem_post(&goMid);
+	uint32_t const before = progress;
+	OS_delay(5U);
+	TEST_CHECK(!midRan);
+	TEST_CHECK(progress != before);
+
+	/* above the threshold: high preempts the worker, then the worker goes on */
+	OSSem_post(&goHigh);
+	OS_delay(2U);
+	TEST_CHECK(highRuns == 1U);
+	TEST_CHECK(!midRan);
+
+	/* lowering the threshold lets mid in */
+	lowerNow = true;
+	OS_delay(2U);
+	TEST_CHECK(lowered);
+	TEST_CHECK(midRan);
+	TEST_PASS();
+}
+
+uint32_t stack_idleThread[TEST_STACK_WORDS];
+
+int main(){
+	OS_init(stack_idleThread, sizeof(stack_idleThread));
+	OSSem_init(&goMid, 0U);
+	OSSem_init(&goHigh, 0U);
+	OSSem_init(&never, 0U);
+
+	OSThread_start(&worker, 2U, &workerThread, stackWorker, sizeof(stackWorker));
+	OSThread_setThreshold(&worker, 4U);
+	OSThread_start(&mid, 3U, &midThread, stackMid, sizeof(stackMid));
+	OSThread_start(&high, 5U, &highThread, stackHigh, sizeof(stackHigh));
+	OSThread_start(&monitor, 9U, &monitorThread, stackMonitor, sizeof(stackMonitor));
+
+	OS_run();
+}
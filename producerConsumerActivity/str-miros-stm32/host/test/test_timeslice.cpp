@@ -0,0 +1,111 @@
+/*
+ * test_timeslice.cpp
+ *
+ * Levels of equals (-DMIROS_TIMESLICE, -DMIROS_PROFILE): three CPU-bound
+ * threads of one level take turns of QUANTUM ticks in descending priority
+ * order, while the thread below the level starves; and a thread alone at
+ * its level keeps the CPU without being switched out.
+ */
+
+#include "test.h"
+
+using namespace rtos;
+
+#define QUANTUM 2U
+#define SOLO_TICKS 20U
+#define LEVEL_TICKS 60U
+
+OSLevel level; /* priorities 2..4, all started */
+OSLevel soloLevel; /* priorities 6..7, only 6 started */
+OSSem never;
+
+/* the turns of the level, as seen by its threads */
+typedef struct {
+	uint16_t prio;
+	uint64_t tick;
+} Turn;
+
+Turn turns[64];
+uint32_t volatile nTurns;
+uint16_t volatile lastPrio;
+uint32_t volatile belowRuns;
+bool volatile soloDone;
+
+template <uint16_t prio>
+void spinner(){
+	while(1){
+		if(lastPrio != prio){
+			uint32_t crit = OS_critEnter();
+			lastPrio = prio;
+			if(nTurns < (sizeof(turns) / sizeof(turns[0]))){
+				turns[nTurns].prio = prio;
+				turns[nTurns].tick = OS_getTicks();
+				nTurns = nTurns + 1U;
+			}
+			OS_critExit(crit);
+		}
+		TEST_CHECK(soloDone);
+	}
+}
+
+uint32_t stackBelow[TEST_STACK_WORDS];
+OSThread below;
+void belowThread(){
+	while(1){
+		belowRuns++;
+	}
+}
+
+uint32_t stackSolo[TEST_STACK_WORDS];
+OSThread solo;
+void soloThread(){
+	test_burn(SOLO_TICKS);
+
+	/* switched in once, and never out while it ran */
+	TEST_CHECK(solo.switches == 1U);
+	TEST_CHECK(nTurns == 0U);
+	soloDone = true;
+	(void)OSSem_pend(&never, OS_WAIT_FOREVER);
+}
+
+uint32_t stackMonitor[TEST_STACK_WORDS];
+OSThread monitor;
+void monitorThread(){
+	OS_delay(SOLO_TICKS + LEVEL_TICKS + 1U);
+
+	TEST_CHECK(solo.switches == 1U);
+	TEST_CHECK(belowRuns == 0U);
+	TEST_CHECK(nTurns >= (LEVEL_TICKS / QUANTUM) - 1U);
+	for(uint32_t i = 0U; (i + 1U) < nTurns; i++){
+		/* descending order, with wrap-around */
+		uint16_t const next = (turns[i].prio == level.lo) ? level.hi : (uint16_t)(turns[i].prio - 1U);
+		TEST_CHECK(turns[i + 1U].prio == next);
+		/* whole turns, but the first one may have begun between two ticks */
+		if(i != 0U){
+			TEST_CHECK((turns[i + 1U].tick - turns[i].tick) == QUANTUM);
+		}
+	}
+	TEST_PASS();
+}
+
+uint32_t stack2[TEST_STACK_WORDS];
+uint32_t stack3[TEST_STACK_WORDS];
+uint32_t stack4[TEST_STACK_WORDS];
+OSThread thread2, thread3, thread4;
+uint32_t stack_idleThread[TEST_STACK_WORDS];
+
+int main(){
+	OS_init(stack_idleThread, sizeof(stack_idleThread));
+	OSSem_init(&never, 0U);
+	OSLevel_init(&level, 2U, 4U, QUANTUM);
+	OSLevel_init(&soloLevel, 6U, 7U, QUANTUM);
+
+	OSThread_start(&below, 1U, &belowThread, stackBelow, sizeof(stackBelow));
+	OSThread_start(&thread2, 2U, &spinner<2U>, stack2, sizeof(stack2));
+	OSThread_start(&thread3, 3U, &spinner<3U>, stack3, sizeof(stack3));
+	OSThread_start(&thread4, 4U, &spinner<4U>, stack4, sizeof(stack4));
+	OSThread_start(&solo, 6U, &soloThread, stackSolo, sizeof(stackSolo));
+	OSThread_start(&monitor, 9U, &monitorThread, stackMonitor, sizeof(stackMonitor));
+
+	OS_run();
+}
@@ -0,0 +1,11 @@
+echo "Compilando código..."
+rm -rf build/*
+mkdir -p build
+cd build
+cmake ..
+make -j$(nproc)
+./traceDecoder "$@"
+
+# Dump do buffer pelo GDB (placa ou servidor GDB do Renode, porta 3333), com MIROS_TRACE:
+# (gdb) dump binary memory trace.bin &rtos::OS_trace ((char *)&rtos::OS_trace) + sizeof(rtos::OS_trace)
+# ./run.sh ../trace.bin -j ../trace.json -n 1=consumer -n 2=producer
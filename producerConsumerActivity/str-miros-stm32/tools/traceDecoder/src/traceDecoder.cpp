@@ -0,0 +1,257 @@
+/*
+ * traceDecoder.cpp
+ *
+ * Host decoder of the MiROS trace recorder (miros_trace.h): reads a binary
+ * dump of rtos::OS_trace, prints the timeline and optionally writes it as
+ * Chrome/Perfetto trace JSON (chrome://tracing, ui.perfetto.dev).
+ *
+ * usage: traceDecoder <dump.bin> [-j <trace.json>] [-n <prio>=<name>]...
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "miros_trace.h"
+
+using namespace std;
+
+/* one decoded record, with the timestamp unwrapped to 64 bits */
+struct Event {
+	uint64_t cycles;
+	rtos::OSTraceRecord rec;
+};
+
+/* track ids of the JSON output besides the threads (tid = priority) */
+static const int TID_ISR = 2000; /* + exception number */
+static const int TID_TICK = 3000;
+static const int TID_KERNEL = 3001; /* events before the first switch */
+
+static map<int, string> threadNames;
+
+static string threadName(int prio) {
+	auto it = threadNames.find(prio);
+	if(it != threadNames.end()){
+		return it->second;
+	}
+	return (prio == 0) ? string("idle") : ("prio " + to_string(prio));
+}
+
+static string isrName(int exception) {
+	switch(exception){
+		case 11: return "SVCall";
+		case 14: return "PendSV";
+		case 15: return "SysTick";
+		default: return "IRQ" + to_string(exception - 16);
+	}
+}
+
+/* semaphores are recorded as address / 4 of a RAM object */
+static string objName(uint16_t id) {
+	char buf[32];
+	snprintf(buf, sizeof(buf), "sem@0x%08X", 0x20000000U | ((uint32_t)id << 2));
+	return buf;
+}
+
+static string describe(rtos::OSTraceRecord const &r) {
+	static char const * const pend[] = { "taken", "blocked", "woken", "timeout" };
+	switch(r.event){
+		case rtos::OS_EVT_CALIB: return "calibration " + to_string(r.param);
+		case rtos::OS_EVT_SWITCH: return "switch to " + threadName(r.id);
+		case rtos::OS_EVT_TICK: return "tick " + to_string(r.id);
+		case rtos::OS_EVT_SEM_PEND: return "pend " + objName(r.id) + " " + ((r.param < 4U) ? pend[r.param] : "?");
+		case rtos::OS_EVT_SEM_POST: return "post " + objName(r.id) + ((r.param != 0U) ? " (wakes a thread)" : "");
+		case rtos::OS_EVT_ISR_ENTER: return "enter " + isrName(r.param);
+		case rtos::OS_EVT_ISR_EXIT: return "exit " + isrName(r.param);
+		default: return "event " + to_string(r.event);
+	}
+}
+
+/* read the dump and return the records oldest first */
+static bool load(char const *path, uint32_t &cpuHz, vector<Event> &events) {
+	ifstream in(path, ios::binary);
+	if(!in){
+		cerr << "cannot open " << path << endl;
+		return false;
+	}
+	vector<char> raw((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+
+	size_t const hdr = offsetof(rtos::OSTraceBuffer, rec);
+	if(raw.size() < hdr){
+		cerr << "dump too short" << endl;
+		return false;
+	}
+	uint32_t magic, head, size;
+	memcpy(&magic, &raw[offsetof(rtos::OSTraceBuffer, magic)], 4);
+	memcpy(&cpuHz, &raw[offsetof(rtos::OSTraceBuffer, cpuHz)], 4);
+	memcpy(&head, &raw[offsetof(rtos::OSTraceBuffer, head)], 4);
+	memcpy(&size, &raw[offsetof(rtos::OSTraceBuffer, size)], 4);
+	if(magic != rtos::OS_TRACE_MAGIC){
+		cerr << "not a MiROS trace (bad magic), was the recorder started?" << endl;
+		return false;
+	}
+	if((size == 0U) || ((size & (size - 1U)) != 0U) || (raw.size() < hdr + size * sizeof(rtos::OSTraceRecord)) || (cpuHz == 0U)){
+		cerr << "corrupt trace header" << endl;
+		return false;
+	}
+
+	/* the ring keeps the last 'size' records */
+	uint32_t const count = (head < size) ? head : size;
+	uint64_t cycles = 0U;
+	uint32_t prev = 0U;
+	for(uint32_t i = head - count; i != head; i++){
+		Event e;
+		memcpy(&e.rec, &raw[hdr + (i & (size - 1U)) * sizeof(rtos::OSTraceRecord)], sizeof(e.rec));
+		if(!events.empty()){
+			cycles += (uint32_t)(e.rec.timestamp - prev); /* CYCCNT wraps every 2^32 cycles */
+		}
+		prev = e.rec.timestamp;
+		e.cycles = cycles;
+		events.push_back(e);
+	}
+	if(head > size){
+		cerr << "note: " << (head - size) << " older records were overwritten" << endl;
+	}
+	return true;
+}
+
+static double toMicros(uint64_t cycles, uint32_t cpuHz) {
+	return (double)cycles * 1e6 / (double)cpuHz;
+}
+
+static void printTimeline(vector<Event> const &events, uint32_t cpuHz) {
+	for(size_t i = 0U; i < events.size(); i++){
+		Event const &e = events[i];
+		printf("%14.3f us  %s\n", toMicros(e.cycles, cpuHz), describe(e.rec).c_str());
+
+		if((e.rec.event == rtos::OS_EVT_CALIB) && (e.rec.param == 1U) && (i > 0U)
+				&& (events[i - 1U].rec.event == rtos::OS_EVT_CALIB)){
+			printf("recorder overhead: %llu cycles per event\n",
+				(unsigned long long)(e.cycles - events[i - 1U].cycles));
+		}
+	}
+}
+
+static void jsonEvent(ofstream &out, bool &first, string const &body) {
+	out << (first ? "\n" : ",\n") << "  {" << body << "}";
+	first = false;
+}
+
+static string quoted(string const &s) {
+	return "\"" + s + "\"";
+}
+
+/* the time a thread held the CPU, as a complete ("X") event */
+static void runSlice(ofstream &out, bool &first, int prio, uint64_t from, uint64_t to, uint32_t cpuHz) {
+	if(prio < 0){
+		return;
+	}
+	char ts[32];
+	char dur[32];
+	snprintf(ts, sizeof(ts), "%.3f", toMicros(from, cpuHz));
+	snprintf(dur, sizeof(dur), "%.3f", toMicros(to - from, cpuHz));
+	jsonEvent(out, first, "\"name\": " + quoted(threadName(prio)) + ", \"ph\": \"X\", \"pid\": 1, \"tid\": "
+		+ to_string(prio) + ", \"ts\": " + ts + ", \"dur\": " + dur);
+}
+
+static void writeJson(char const *path, vector<Event> const &events, uint32_t cpuHz) {
+	ofstream out(path);
+	bool first = true;
+	char ts[32];
+	map<int, string> tracks;
+
+	out << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+
+	int running = -1; /* thread switched in last */
+	uint64_t since = 0U;
+	for(Event const &e : events){
+		snprintf(ts, sizeof(ts), "%.3f", toMicros(e.cycles, cpuHz));
+		string const common = string("\"pid\": 1, \"ts\": ") + ts;
+		switch(e.rec.event){
+			case rtos::OS_EVT_SWITCH: {
+				runSlice(out, first, running, since, e.cycles, cpuHz);
+				running = e.rec.id;
+				since = e.cycles;
+				tracks[running] = threadName(running);
+				break;
+			}
+			case rtos::OS_EVT_ISR_ENTER:
+			case rtos::OS_EVT_ISR_EXIT: {
+				int const tid = TID_ISR + e.rec.param;
+				tracks[tid] = isrName(e.rec.param);
+				jsonEvent(out, first, "\"name\": " + quoted(isrName(e.rec.param)) + ", \"ph\": \""
+					+ ((e.rec.event == rtos::OS_EVT_ISR_ENTER) ? "B" : "E") + "\", " + common + ", \"tid\": " + to_string(tid));
+				break;
+			}
+			case rtos::OS_EVT_TICK:
+				tracks[TID_TICK] = "ticks";
+				jsonEvent(out, first, "\"name\": " + quoted(describe(e.rec)) + ", \"ph\": \"i\", \"s\": \"t\", "
+					+ common + ", \"tid\": " + to_string(TID_TICK));
+				break;
+			default: {
+				/* kernel calls show up on the track of the running thread */
+				int const tid = (running >= 0) ? running : TID_KERNEL;
+				tracks[tid] = (running >= 0) ? threadName(running) : "kernel";
+				jsonEvent(out, first, "\"name\": " + quoted(describe(e.rec)) + ", \"ph\": \"i\", \"s\": \"t\", "
+					+ common + ", \"tid\": " + to_string(tid));
+				break;
+			}
+		}
+	}
+
+	if(!events.empty()){
+		runSlice(out, first, running, since, events.back().cycles, cpuHz);
+	}
+
+	for(auto const &t : tracks){
+		jsonEvent(out, first, "\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " + to_string(t.first)
+			+ ", \"args\": {\"name\": " + quoted(t.second) + "}");
+		/* threads first, by priority, then the ISRs and the ticks */
+		jsonEvent(out, first, "\"name\": \"thread_sort_index\", \"ph\": \"M\", \"pid\": 1, \"tid\": " + to_string(t.first)
+			+ ", \"args\": {\"sort_index\": " + to_string((t.first < TID_ISR) ? -t.first : t.first) + "}");
+	}
+	out << "\n]}\n";
+}
+
+int main(int argc, char *argv[]) {
+	char const *dump = nullptr;
+	char const *json = nullptr;
+	for(int i = 1; i < argc; i++){
+		if((strcmp(argv[i], "-j") == 0) && (i + 1 < argc)){
+			json = argv[++i];
+		}else if((strcmp(argv[i], "-n") == 0) && (i + 1 < argc)){
+			string const arg = argv[++i];
+			size_t const eq = arg.find('=');
+			if(eq == string::npos){
+				cerr << "expected -n <prio>=<name>" << endl;
+				return 1;
+			}
+			threadNames[stoi(arg.substr(0, eq))] = arg.substr(eq + 1);
+		}else{
+			dump = argv[i];
+		}
+	}
+	if(dump == nullptr){
+		cerr << "usage: traceDecoder <dump.bin> [-j <trace.json>] [-n <prio>=<name>]..." << endl;
+		return 1;
+	}
+
+	uint32_t cpuHz = 0U;
+	vector<Event> events;
+	if(!load(dump, cpuHz, events)){
+		return 1;
+	}
+
+	printTimeline(events, cpuHz);
+	if(json != nullptr){
+		writeJson(json, events, cpuHz);
+	}
+	return 0;
+}